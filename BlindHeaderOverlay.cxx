@@ -0,0 +1,77 @@
+#include "BlindHeaderOverlay.h"
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include <iostream>
+
+BlindHeaderOverlay::BlindHeaderOverlay(const char* fileName){
+  if(fileName){
+    readFile(fileName);
+  }
+}
+
+
+Int_t BlindHeaderOverlay::readFile(const char* fileName){
+
+  TFile* overlayFile = TFile::Open(fileName);
+  TTree* overlayTree = overlayFile ? (TTree*) overlayFile->Get("blindOverlayTree") : NULL;
+  if(overlayTree==NULL){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to find blindOverlayTree in " << fileName << std::endl;
+    delete overlayFile;
+    return 0;
+  }
+
+  RawAnitaHeader* header = NULL;
+  overlayTree->SetBranchAddress("header", &header);
+
+  const Long64_t nEntries = overlayTree->GetEntries();
+  for(Long64_t entry=0; entry < nEntries; entry++){
+    overlayTree->GetEntry(entry);
+    fIndex.addEvent(header->eventNumber, fHeaders.size());
+    fHeaders.push_back(*header);
+  }
+  fIndex.build();
+
+  overlayFile->Close();
+  delete overlayFile;
+  delete header;
+
+  return nEntries;
+}
+
+
+Int_t BlindHeaderOverlay::writeFile(const char* fileName, const std::vector<RawAnitaHeader>& blindedHeaders){
+
+  TFile* overlayFile = new TFile(fileName, "recreate");
+  if(overlayFile->IsZombie()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open " << fileName << std::endl;
+    delete overlayFile;
+    return 1;
+  }
+
+  TTree* overlayTree = new TTree("blindOverlayTree", "Overwritten Anita Headers");
+  UInt_t eventNumber = 0;
+  RawAnitaHeader* header = NULL;
+  overlayTree->Branch("eventNumber", &eventNumber);
+  overlayTree->Branch("header", &header);
+
+  for(UInt_t i=0; i < blindedHeaders.size(); i++){
+    header = const_cast<RawAnitaHeader*>(&blindedHeaders.at(i));
+    eventNumber = header->eventNumber;
+    overlayTree->Fill();
+  }
+  overlayTree->BuildIndex("eventNumber");
+
+  overlayFile->Write();
+  overlayFile->Close();
+  delete overlayFile;
+
+  return 0;
+}
+
+
+const RawAnitaHeader* BlindHeaderOverlay::getHeader(UInt_t eventNumber) const {
+  const Int_t overlayEntry = fIndex.getFakeTreeEntry(eventNumber);
+  return overlayEntry >= 0 ? &fHeaders.at(overlayEntry) : NULL;
+}
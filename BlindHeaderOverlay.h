@@ -0,0 +1,55 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Sparse alternative to the full blindHeadFileV*_X.root copies.
+             Holds only the overwritten RawAnitaHeaders, keyed by eventNumber, and swaps them in on the fly
+             while reading the original timedHeadFile*OfflineMask.root chain. e.g.
+
+               BlindHeaderOverlay overlay("blindHeadOverlayV3_130_439.root");
+               headChain->GetEntry(entry);
+               overlay.apply(header);
+*************************************************************************************************************** */
+
+#ifndef BLINDHEADEROVERLAY_H
+#define BLINDHEADEROVERLAY_H
+
+#include "RawAnitaHeader.h"
+#include "BlindingManifest.h"
+
+#include <vector>
+
+class BlindHeaderOverlay {
+
+public:
+
+  BlindHeaderOverlay(const char* fileName = NULL);
+
+  Int_t readFile(const char* fileName);
+  static Int_t writeFile(const char* fileName, const std::vector<RawAnitaHeader>& blindedHeaders);
+
+  // If header is one of the overwritten events, replace it with the blinded version.
+  // Returns true if the header was replaced.
+  inline Bool_t apply(RawAnitaHeader* header) const {
+    const Int_t overlayEntry = fIndex.getFakeTreeEntry(header->eventNumber);
+    if(overlayEntry < 0){
+      return false;
+    }
+    (*header) = fHeaders.at(overlayEntry);
+    return true;
+  }
+
+  // returns NULL if eventNumber isn't in the overlay
+  const RawAnitaHeader* getHeader(UInt_t eventNumber) const;
+
+  size_t size() const {return fHeaders.size();}
+
+private:
+
+  BlindingManifest fIndex; // eventNumber -> index in fHeaders, same fast miss as the blinding manifest
+  std::vector<RawAnitaHeader> fHeaders;
+};
+
+#endif
@@ -0,0 +1,112 @@
+#include "BlindingManifest.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+
+BlindingManifest::BlindingManifest(){
+  fMinEventNumber = 0;
+  fMaxEventNumber = 0;
+  fBuilt = false;
+  build();
+}
+
+
+Int_t BlindingManifest::readFile(const char* fileName){
+
+  std::ifstream manifestFile(fileName);
+  if(!manifestFile.is_open()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open " << fileName << std::endl;
+    return 0;
+  }
+
+  char firstLine[180];
+  manifestFile.getline(firstLine,179);
+  UInt_t overwrittenEventNumber;
+  Int_t fakeTreeEntry;
+  Int_t numRead = 0;
+  while(manifestFile >> overwrittenEventNumber >> fakeTreeEntry){
+    addEvent(overwrittenEventNumber, fakeTreeEntry);
+    numRead++;
+  }
+  build();
+
+  return numRead;
+}
+
+
+void BlindingManifest::addEvent(UInt_t eventNumber, Int_t fakeTreeEntry){
+  fEventNumbers.push_back(eventNumber);
+  fFakeTreeEntries.push_back(fakeTreeEntry);
+  fBuilt = false;
+}
+
+
+void BlindingManifest::build(){
+
+  // sort by eventNumber, the stable sort keeps the file order for any repeated eventNumbers
+  std::vector<std::pair<UInt_t, Int_t> > pairs;
+  for(UInt_t i=0; i < fEventNumbers.size(); i++){
+    pairs.push_back(std::pair<UInt_t, Int_t>(fEventNumbers.at(i), fFakeTreeEntries.at(i)));
+  }
+  std::stable_sort(pairs.begin(), pairs.end(),
+		   [](const std::pair<UInt_t, Int_t>& a, const std::pair<UInt_t, Int_t>& b){return a.first < b.first;});
+
+  fEventNumbers.clear();
+  fFakeTreeEntries.clear();
+  for(UInt_t i=0; i < pairs.size(); i++){
+    if(fEventNumbers.size() > 0 && fEventNumbers.back()==pairs.at(i).first){
+      // the old linear scan used the first match, so do the same
+      std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", eventNumber " << pairs.at(i).first
+		<< " is listed more than once, using fakeTreeEntry " << fFakeTreeEntries.back() << std::endl;
+      continue;
+    }
+    fEventNumbers.push_back(pairs.at(i).first);
+    fFakeTreeEntries.push_back(pairs.at(i).second);
+  }
+
+  fMinEventNumber = fEventNumbers.size() > 0 ? fEventNumbers.front() : 0;
+  fMaxEventNumber = fEventNumbers.size() > 0 ? fEventNumbers.back() : 0;
+
+  // power of 2 number of filter bits, so a bit index is just the top bits of the hash
+  Int_t log2FilterBits = 0;
+  while((1u << log2FilterBits) < kMinFilterBits ||
+	(1u << log2FilterBits) < kFilterBitsPerEvent*fEventNumbers.size()){
+    log2FilterBits++;
+    if(log2FilterBits==31) break;
+  }
+  fFilterShift = 32 - log2FilterBits;
+  fFilter.assign((1u << log2FilterBits)/64, 0);
+
+  for(UInt_t i=0; i < fEventNumbers.size(); i++){
+    const UInt_t bit = (fEventNumbers.at(i)*kHashMultiplier) >> fFilterShift;
+    fFilter.at(bit >> 6) |= (1ull << (bit & 63));
+  }
+
+  fBuilt = true;
+}
+
+
+Int_t BlindingManifest::findFakeTreeEntry(UInt_t eventNumber) const {
+
+  if(!fBuilt){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", call build() after addEvent()" << std::endl;
+    return -1;
+  }
+  if(eventNumber < fMinEventNumber || eventNumber > fMaxEventNumber){
+    return -1;
+  }
+
+  std::vector<UInt_t>::const_iterator it = std::lower_bound(fEventNumbers.begin(), fEventNumbers.end(), eventNumber);
+  if(it!=fEventNumbers.end() && *it==eventNumber){
+    return fFakeTreeEntries.at(it - fEventNumbers.begin());
+  }
+  return -1;
+}
+
+
+Bool_t BlindingManifest::hasEventInRange(UInt_t firstEventNumber, UInt_t lastEventNumber) const {
+
+  std::vector<UInt_t>::const_iterator it = std::lower_bound(fEventNumbers.begin(), fEventNumbers.end(), firstEventNumber);
+  return it!=fEventNumbers.end() && *it <= lastEventNumber;
+}
@@ -0,0 +1,70 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Compiled lookup of the blinding manifest (anita3OverwrittenEventInfo.txt).
+             Maps eventNumber -> fakeTreeEntry, designed to be asked about every header in the flight.
+             Only depends on ROOT basic types so it can be dropped into the eventReaderRoot calibrator too.
+*************************************************************************************************************** */
+
+#ifndef BLINDINGMANIFEST_H
+#define BLINDINGMANIFEST_H
+
+#include "Rtypes.h"
+#include <vector>
+
+class BlindingManifest {
+
+public:
+
+  BlindingManifest();
+
+  // reads the "eventNumber fakeTreeEntry" text file (one header line), returns the number of events read
+  Int_t readFile(const char* fileName);
+
+  // add a single eventNumber/fakeTreeEntry pair, call build() before doing any lookups
+  void addEvent(UInt_t eventNumber, Int_t fakeTreeEntry);
+  void build();
+
+  // returns the fakeTreeEntry to overwrite eventNumber with, or -1 if not in the manifest
+  inline Int_t getFakeTreeEntry(UInt_t eventNumber) const {
+
+    // the overwhelming majority of headers are not in the manifest,
+    // so the bit test is the only thing a miss should cost
+    const UInt_t bit = (eventNumber*kHashMultiplier) >> fFilterShift;
+    if(((fFilter[bit >> 6] >> (bit & 63)) & 1)==0){
+      return -1;
+    }
+    return findFakeTreeEntry(eventNumber);
+  }
+
+  // is there any manifest eventNumber in [firstEventNumber, lastEventNumber]?
+  Bool_t hasEventInRange(UInt_t firstEventNumber, UInt_t lastEventNumber) const;
+
+  size_t size() const {return fEventNumbers.size();}
+  UInt_t getMinEventNumber() const {return fMinEventNumber;}
+  UInt_t getMaxEventNumber() const {return fMaxEventNumber;}
+  const std::vector<UInt_t>& getEventNumbers() const {return fEventNumbers;}
+  const std::vector<Int_t>& getFakeTreeEntries() const {return fFakeTreeEntries;}
+
+private:
+
+  Int_t findFakeTreeEntry(UInt_t eventNumber) const;
+
+  static const UInt_t kHashMultiplier = 2654435761u; // Knuth's multiplicative hash
+  static const UInt_t kFilterBitsPerEvent = 256;     // keeps false positives well below 1%
+  static const UInt_t kMinFilterBits = 4096;
+
+  std::vector<UInt_t> fEventNumbers; // sorted
+  std::vector<Int_t> fFakeTreeEntries; // same order as fEventNumbers
+  UInt_t fMinEventNumber;
+  UInt_t fMaxEventNumber;
+
+  std::vector<ULong64_t> fFilter; // bloom-style bit set, one hash
+  Int_t fFilterShift;
+  Bool_t fBuilt;
+};
+
+#endif
@@ -0,0 +1,132 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             The random part of makeAnita3OverwrittenEventList: how many events to overwrite, which fake pulses to
+             use, and which minimum bias events they replace. Templated on the random number generator, so the
+             production selection (TRandom3 with the mashed keyboard seed) and the Monte Carlo trials
+             (CounterRandom, one stream per trial) are exactly the same procedure.
+*************************************************************************************************************** */
+
+#ifndef BLINDINGSELECTION_H
+#define BLINDINGSELECTION_H
+
+#include "MinBiasCandidatePool.h"
+#include "GeolocationBatch.h"
+
+#include <vector>
+
+namespace BlindingSelection {
+
+  // Direction of the biggest VPol peak of a fake pulse, from its reconstruction
+  struct FakePulsePeak {
+    Double_t phi;
+    Double_t theta;
+  };
+
+  struct SelectedEvent {
+    Int_t fakeTreeEntry;
+    Int_t candidateInd; // in the MinBiasCandidatePool
+    Long64_t numTries; // random seconds drawn to find it
+    GeolocationBatch::Result result;
+  };
+
+  // Something seems wrong if it takes more tries than this
+  const Long64_t maxTries = 1000000;
+
+  template <class RNG>
+  void selectFakeTreeEntries(RNG& rnd, Int_t numPulses, std::vector<Int_t>& fakeTreeEntries){
+
+    const int N = rnd.Uniform(10, 15);
+
+    std::vector<Int_t> fakeTreeEntriesAvailable(numPulses, 1);
+    for(int i=0; i < N; i++){
+
+      Int_t fakeTreeEntry = -1;
+      bool unusedEntry=false;
+      while(unusedEntry==false){
+
+	Int_t tryThisEntry = rnd.Uniform(0, numPulses);
+	if(fakeTreeEntriesAvailable.at(tryThisEntry) == 1){
+	  fakeTreeEntry = tryThisEntry;
+	  fakeTreeEntriesAvailable.at(tryThisEntry) = 0;
+	  unusedEntry = true;
+	}
+      }
+      fakeTreeEntries.push_back(fakeTreeEntry);
+    }
+  }
+
+  // Draws random seconds in [firstRealTime, lastRealTime) until one lands on an acceptable candidate.
+  // Tries are geolocated batchSize at a time from a copy of rnd, which is then moved on by the number of
+  // tries actually used, so rnd ends up exactly where trying them one at a time would leave it.
+  // Returns 1 if there's nothing acceptable in maxTries.
+  template <class RNG>
+  Int_t selectCandidate(RNG& rnd, const MinBiasCandidatePool& pool, const GeolocationBatch& geolocator,
+			const FakePulsePeak& peak, UInt_t firstRealTime, UInt_t lastRealTime, Int_t batchSize,
+			SelectedEvent& selected){
+
+    std::vector<Int_t> batchCandidateInds(batchSize, -1);
+    std::vector<GeolocationBatch::Result> batchResults;
+
+    Long64_t numTries = 0;
+    selected.candidateInd = -1;
+    while(selected.candidateInd < 0){
+
+      RNG rndBatch(rnd);
+      for(Int_t tryInd=0; tryInd < batchSize; tryInd++){
+	// Pick any event from within the time window
+	UInt_t randomTime = rndBatch.Uniform(firstRealTime, lastRealTime);
+	// the pool only has soft/ext triggered events that aren't in the decimated data set
+	batchCandidateInds[tryInd] = pool.find(randomTime);
+      }
+
+      geolocator.evaluate(batchCandidateInds, peak.phi, peak.theta, batchResults);
+
+      Int_t numUsed = batchSize;
+      for(Int_t tryInd=0; tryInd < batchSize; tryInd++){
+	if(numTries >= maxTries){
+	  return 1;
+	}
+	numTries++;
+
+	if(batchCandidateInds[tryInd] >= 0 && batchResults[tryInd].accepted()){
+	  selected.candidateInd = batchCandidateInds[tryInd];
+	  selected.result = batchResults[tryInd];
+	  numUsed = tryInd + 1;
+	  break;
+	}
+      }
+      for(Int_t tryInd=0; tryInd < numUsed; tryInd++){
+	rnd.Uniform(firstRealTime, lastRealTime);
+      }
+    }
+    selected.numTries = numTries;
+    return 0;
+  }
+
+  // The whole selection, peaks is indexed by fakeTreeEntry
+  template <class RNG>
+  Int_t select(RNG& rnd, const MinBiasCandidatePool& pool, const GeolocationBatch& geolocator,
+	       const std::vector<FakePulsePeak>& peaks, UInt_t firstRealTime, UInt_t lastRealTime, Int_t batchSize,
+	       std::vector<SelectedEvent>& selectedEvents){
+
+    std::vector<Int_t> fakeTreeEntries;
+    selectFakeTreeEntries(rnd, peaks.size(), fakeTreeEntries);
+
+    for(UInt_t i=0; i < fakeTreeEntries.size(); i++){
+      SelectedEvent selected;
+      selected.fakeTreeEntry = fakeTreeEntries.at(i);
+      if(selectCandidate(rnd, pool, geolocator, peaks.at(selected.fakeTreeEntry),
+			 firstRealTime, lastRealTime, batchSize, selected)!=0){
+	return 1;
+      }
+      selectedEvents.push_back(selected);
+    }
+    return 0;
+  }
+}
+
+#endif
@@ -0,0 +1,47 @@
+#include "CalEventReader.h"
+
+#include "TTree.h"
+#include "TBranch.h"
+#include "TString.h"
+
+#include "UsefulAnitaEvent.h"
+#include "CalibratedAnitaEvent.h"
+
+#include <iostream>
+
+
+
+CalEventReader::CalEventReader(){
+  fIsCalibrated = false;
+  fCalEvent = NULL;
+  fUsefulEvent = NULL;
+}
+
+
+
+Int_t CalEventReader::setBranchAddress(TTree* eventTree){
+
+  TBranch* branch = eventTree!=NULL ? eventTree->GetBranch("event") : NULL;
+  if(branch==NULL){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", no event branch to read" << std::endl;
+    return 1;
+  }
+
+  fIsCalibrated = TString(branch->GetClassName())=="UsefulAnitaEvent";
+  if(fIsCalibrated){
+    eventTree->SetBranchAddress("event", &fUsefulEvent);
+  }
+  else{
+    eventTree->SetBranchAddress("event", &fCalEvent);
+  }
+  return 0;
+}
+
+
+
+UsefulAnitaEvent* CalEventReader::makeUsefulEvent() const {
+  if(fIsCalibrated){
+    return fUsefulEvent!=NULL ? new UsefulAnitaEvent(*fUsefulEvent) : NULL;
+  }
+  return fCalEvent!=NULL ? new UsefulAnitaEvent(fCalEvent) : NULL;
+}
@@ -0,0 +1,47 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Reads the "event" branch of a calEventFile's eventTree. The flight files hold CalibratedAnitaEvents,
+             which are calibrated into a UsefulAnitaEvent as they're used. makeSyntheticAnita3Data writes
+             UsefulAnitaEvents, already in mV, as it has no ADC counts to calibrate: a CalibratedAnitaEvent
+             made from its waveforms would lose them again in new UsefulAnitaEvent(calEvent).
+             Which one a tree holds is taken from the branch, so the readers work with either.
+*************************************************************************************************************** */
+
+#ifndef CALEVENTREADER_H
+#define CALEVENTREADER_H
+
+#include "Rtypes.h"
+
+class TTree;
+class CalibratedAnitaEvent;
+class UsefulAnitaEvent;
+
+class CalEventReader {
+
+public:
+
+  CalEventReader();
+
+  // Points eventTree's "event" branch here, returns 0 on success.
+  // The tree makes the event it reads into, so it has to outlive this.
+  Int_t setBranchAddress(TTree* eventTree);
+
+  // Are the events already in mV?
+  Bool_t isCalibrated() const {return fIsCalibrated;}
+
+  // A new UsefulAnitaEvent for the entry last read, which the caller deletes, NULL if nothing has been read.
+  // Calibrating goes through the AnitaEventCalibrator singleton, so threads need to take turns.
+  UsefulAnitaEvent* makeUsefulEvent() const;
+
+private:
+
+  Bool_t fIsCalibrated;
+  CalibratedAnitaEvent* fCalEvent;
+  UsefulAnitaEvent* fUsefulEvent;
+};
+
+#endif
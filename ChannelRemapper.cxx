@@ -0,0 +1,206 @@
+#include "ChannelRemapper.h"
+
+#include "AnitaGeomTool.h"
+#include "UsefulAnitaEvent.h"
+#include "RawAnitaHeader.h"
+
+#include <cstring>
+
+namespace {
+
+  // ((x % n) + n) % n so negative rotations work too
+  Int_t phiShift(Int_t numPhiSectors){
+    return ((numPhiSectors % NUM_PHI) + NUM_PHI) % NUM_PHI;
+  }
+
+  // prioritizerStuff: bit 0 is the peak polarization, bits 1-6 the peak phi bin, 4 bins per phi sector
+  const UShort_t peakPhiBinMask = 0x7e;
+  const Int_t peakPhiBinShift = 1;
+  const Int_t numPeakPhiBins = 64;
+}
+
+ChannelRemapper::ChannelRemapper(){
+  Int_t source[NUM_DIGITZED_CHANNELS];
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    source[chanIndex] = chanIndex;
+  }
+  setSource(source);
+}
+
+
+
+ChannelRemapper ChannelRemapper::polarizationSwap(){
+
+  Int_t source[NUM_DIGITZED_CHANNELS];
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    source[chanIndex] = chanIndex;
+  }
+  for(Int_t ant=0; ant < NUM_SEAVEYS; ant++){
+    Int_t hIndex = AnitaGeomTool::getChanIndexFromAntPol(ant, AnitaPol::kHorizontal);
+    Int_t vIndex = AnitaGeomTool::getChanIndexFromAntPol(ant, AnitaPol::kVertical);
+    source[hIndex] = vIndex;
+    source[vIndex] = hIndex;
+  }
+
+  ChannelRemapper remapper;
+  remapper.setSource(source);
+  return remapper;
+}
+
+
+
+ChannelRemapper ChannelRemapper::phiSectorRotation(Int_t numPhiSectors){
+
+  Int_t source[NUM_DIGITZED_CHANNELS];
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    source[chanIndex] = chanIndex;
+  }
+
+  const Int_t shift = phiShift(numPhiSectors);
+  for(Int_t ant=0; ant < NUM_SEAVEYS; ant++){
+    Int_t phi = AnitaGeomTool::getPhiFromAnt(ant);
+    AnitaRing::AnitaRing_t ring = AnitaGeomTool::getRingFromAnt(ant);
+    Int_t destAnt = AnitaGeomTool::getAntFromPhiRing((phi + shift) % NUM_PHI, ring);
+    for(Int_t polInd=0; polInd < AnitaPol::kNotAPol; polInd++){
+      AnitaPol::AnitaPol_t pol = (AnitaPol::AnitaPol_t) polInd;
+      source[AnitaGeomTool::getChanIndexFromAntPol(destAnt, pol)] = AnitaGeomTool::getChanIndexFromAntPol(ant, pol);
+    }
+  }
+
+  ChannelRemapper remapper;
+  remapper.setSource(source);
+  return remapper;
+}
+
+
+
+ChannelRemapper ChannelRemapper::combine(const ChannelRemapper& first, const ChannelRemapper& second){
+
+  // second takes its chanIndex from second.getSource(chanIndex), which first filled from first.getSource(...)
+  Int_t source[NUM_DIGITZED_CHANNELS];
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    source[chanIndex] = first.getSource(second.getSource(chanIndex));
+  }
+
+  ChannelRemapper remapper;
+  remapper.setSource(source);
+  return remapper;
+}
+
+
+
+Bool_t ChannelRemapper::crossesSurfs() const {
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    Int_t surfIn, chanIn, surfOut, chanOut;
+    AnitaGeomTool::getSurfChanFromChanIndex(fSource[chanIndex], surfIn, chanIn);
+    AnitaGeomTool::getSurfChanFromChanIndex(chanIndex, surfOut, chanOut);
+    if(surfIn != surfOut){
+      return true;
+    }
+  }
+  return false;
+}
+
+
+
+void ChannelRemapper::setSource(const Int_t* source){
+
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    fSource[chanIndex] = source[chanIndex];
+    fDestination[source[chanIndex]] = chanIndex;
+  }
+
+  // Follow each channel back through its sources until we get back to it
+  fCycleChans.clear();
+  fCycleStarts.clear();
+  std::vector<Int_t> done(NUM_DIGITZED_CHANNELS, 0);
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    if(done[chanIndex] || fSource[chanIndex]==chanIndex){
+      continue;
+    }
+    fCycleStarts.push_back(fCycleChans.size());
+    Int_t c = chanIndex;
+    while(!done[c]){
+      fCycleChans.push_back(c);
+      done[c] = 1;
+      c = fSource[c];
+    }
+  }
+  fCycleStarts.push_back(fCycleChans.size());
+}
+
+
+
+void ChannelRemapper::permuteRows(void* rows, size_t rowBytes) const {
+
+  char* base = (char*) rows;
+  char scratch[NUM_SAMP*sizeof(Double_t)];
+
+  for(UInt_t cycleInd=0; cycleInd + 1 < fCycleStarts.size(); cycleInd++){
+    const Int_t first = fCycleStarts[cycleInd];
+    const Int_t last = fCycleStarts[cycleInd+1] - 1;
+
+    // c0 <- c1 <- ... <- cN <- (old c0)
+    memcpy(scratch, base + fCycleChans[first]*rowBytes, rowBytes);
+    for(Int_t i=first; i < last; i++){
+      memcpy(base + fCycleChans[i]*rowBytes, base + fCycleChans[i+1]*rowBytes, rowBytes);
+    }
+    memcpy(base + fCycleChans[last]*rowBytes, scratch, rowBytes);
+  }
+}
+
+
+
+void ChannelRemapper::apply(UsefulAnitaEvent* usefulEvent) const {
+
+  permuteRows(usefulEvent->data, sizeof(usefulEvent->data[0]));
+  permuteRows(usefulEvent->xMax, sizeof(usefulEvent->xMax[0]));
+  permuteRows(usefulEvent->xMin, sizeof(usefulEvent->xMin[0]));
+  permuteRows(usefulEvent->mean, sizeof(usefulEvent->mean[0]));
+  permuteRows(usefulEvent->rms, sizeof(usefulEvent->rms[0]));
+  permuteRows(usefulEvent->fNumPoints, sizeof(usefulEvent->fNumPoints[0]));
+  permuteRows(usefulEvent->fVolts, sizeof(usefulEvent->fVolts[0]));
+  permuteRows(usefulEvent->fTimes, sizeof(usefulEvent->fTimes[0]));
+}
+
+
+
+UShort_t ChannelRemapper::rotatePhiBits(UShort_t bits, Int_t numPhiSectors){
+  const Int_t shift = phiShift(numPhiSectors);
+  if(shift==0){
+    return bits;
+  }
+  return (UShort_t) (((bits << shift) | (bits >> (NUM_PHI - shift))) & 0xffff);
+}
+
+
+
+void ChannelRemapper::rotateHeader(RawAnitaHeader* header, Int_t numPhiSectors){
+
+  header->l1TrigMask = rotatePhiBits(header->l1TrigMask, numPhiSectors);
+  header->l1TrigMaskH = rotatePhiBits(header->l1TrigMaskH, numPhiSectors);
+  header->phiTrigMask = rotatePhiBits(header->phiTrigMask, numPhiSectors);
+  header->phiTrigMaskH = rotatePhiBits(header->phiTrigMaskH, numPhiSectors);
+  header->l1TrigMaskOffline = rotatePhiBits(header->l1TrigMaskOffline, numPhiSectors);
+  header->l1TrigMaskHOffline = rotatePhiBits(header->l1TrigMaskHOffline, numPhiSectors);
+  header->phiTrigMaskOffline = rotatePhiBits(header->phiTrigMaskOffline, numPhiSectors);
+  header->phiTrigMaskHOffline = rotatePhiBits(header->phiTrigMaskHOffline, numPhiSectors);
+  header->l3TrigPattern = rotatePhiBits(header->l3TrigPattern, numPhiSectors);
+  header->l3TrigPatternH = rotatePhiBits(header->l3TrigPatternH, numPhiSectors);
+
+  const Int_t peakPhiBin = (header->prioritizerStuff & peakPhiBinMask) >> peakPhiBinShift;
+  const Int_t rotatedBin = (peakPhiBin + phiShift(numPhiSectors)*numPeakPhiBins/NUM_PHI) % numPeakPhiBins;
+  header->prioritizerStuff = (header->prioritizerStuff & ~peakPhiBinMask) | (rotatedBin << peakPhiBinShift);
+}
+
+
+
+Double_t ChannelRemapper::rotateHeading(Double_t heading, Int_t numPhiSectors){
+
+  // The source is at heading - phi, so phi + delta needs heading + delta
+  Double_t rotated = heading + phiShift(numPhiSectors)*360./NUM_PHI;
+  while(rotated >= 360){
+    rotated -= 360;
+  }
+  return rotated;
+}
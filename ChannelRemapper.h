@@ -0,0 +1,79 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Moves the channels of a UsefulAnitaEvent around: swapping the polarizations, rotating in phi, or both.
+             The permutation is worked out from AnitaGeomTool once and stored as cycles, so applying it is a
+             handful of whole-row memcpys per channel with one row of scratch space, rather than a second event.
+             Channels that aren't antennas (the clocks) stay where they are.
+
+             A phi rotated event also needs its header rotated to match, rotateHeader() does the phi
+             dependent fields the same way phiSectorRotation() moves the channels.
+*************************************************************************************************************** */
+
+#ifndef CHANNELREMAPPER_H
+#define CHANNELREMAPPER_H
+
+#include "Rtypes.h"
+#include "AnitaConventions.h"
+
+#include <vector>
+#include <cstddef>
+
+class UsefulAnitaEvent;
+class RawAnitaHeader;
+
+class ChannelRemapper {
+
+public:
+
+  // Leaves everything where it is
+  ChannelRemapper();
+
+  // HPol of each antenna goes to VPol and vice versa
+  static ChannelRemapper polarizationSwap();
+
+  // Antenna in phi sector phi goes to phi sector phi + numPhiSectors, same ring and polarization
+  static ChannelRemapper phiSectorRotation(Int_t numPhiSectors);
+
+  // Does first then second
+  static ChannelRemapper combine(const ChannelRemapper& first, const ChannelRemapper& second);
+
+  // The channel that ends up in chanIndex, and where chanIndex ends up
+  Int_t getSource(Int_t chanIndex) const {return fSource[chanIndex];}
+  Int_t getDestination(Int_t chanIndex) const {return fDestination[chanIndex];}
+
+  // True if any channel is moved to a different SURF
+  Bool_t crossesSurfs() const;
+
+  // Moves data, xMax, xMin, mean, rms, fNumPoints, fVolts and fTimes in place
+  void apply(UsefulAnitaEvent* usefulEvent) const;
+
+  // Bit phi of a 16 bit per phi sector trigger mask/pattern goes to bit phi + numPhiSectors
+  static UShort_t rotatePhiBits(UShort_t bits, Int_t numPhiSectors);
+
+  // The trigger masks and patterns and the prioritizer's peak phi bin, as phiSectorRotation(numPhiSectors)
+  // would move them. peakThetaBin doesn't depend on phi so it's left alone.
+  static void rotateHeader(RawAnitaHeader* header, Int_t numPhiSectors);
+
+  // The heading (degrees) that points a phi rotated event's source the same way as before
+  static Double_t rotateHeading(Double_t heading, Int_t numPhiSectors);
+
+private:
+
+  void setSource(const Int_t* source);
+
+  // Permutes NUM_DIGITZED_CHANNELS rows of rowBytes starting at rows
+  void permuteRows(void* rows, size_t rowBytes) const;
+
+  Int_t fSource[NUM_DIGITZED_CHANNELS];
+  Int_t fDestination[NUM_DIGITZED_CHANNELS];
+
+  // Each cycle is c0 <- c1 <- c2 ... <- c0, channels that don't move aren't in any
+  std::vector<Int_t> fCycleChans;
+  std::vector<Int_t> fCycleStarts; // into fCycleChans, with a final entry at the end
+};
+
+#endif
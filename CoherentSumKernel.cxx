@@ -0,0 +1,239 @@
+#include "CoherentSumKernel.h"
+#include "FFTWPlanner.h"
+#include "WaveformSnr.h"
+
+#include "TMath.h"
+
+#include "UsefulAnitaEvent.h"
+#include "AnitaGeomTool.h"
+#include "RootTools.h"
+
+#include <fftw3.h>
+
+#include <cstring>
+
+namespace {
+  const Double_t speedOfLightMPerNs = 0.299792458;
+}
+
+
+
+CoherentSumKernel::CoherentSumKernel(Int_t numSamples, Double_t deltaT, Int_t upsampleFactor){
+
+  fNumSamples = numSamples;
+  fNumPadded = 2*numSamples;
+  fNumFreqs = fNumPadded/2 + 1;
+  fNumUpsampled = fNumPadded*upsampleFactor;
+  fDeltaT = deltaT;
+  fDeltaF = 1./(deltaT*fNumPadded);
+
+  AnitaGeomTool* geom = AnitaGeomTool::Instance();
+  for(Int_t polInd=0; polInd < AnitaPol::kNotAPol; polInd++){
+    AnitaPol::AnitaPol_t pol = (AnitaPol::AnitaPol_t) polInd;
+    for(Int_t ant=0; ant < NUM_SEAVEYS; ant++){
+      fR[pol][ant] = geom->getAntR(ant, pol);
+      fZ[pol][ant] = geom->getAntZ(ant, pol);
+      fPhi[pol][ant] = geom->getAntPhiPositionRelToAftFore(ant, pol);
+      fSpectra[pol][ant].assign(2*fNumFreqs, 0);
+    }
+  }
+
+  fTimeBuffer = fftw_alloc_real(fNumPadded);
+  fftw_complex* freqBuffer = fftw_alloc_complex(fNumFreqs);
+  fftw_complex* sumBuffer = fftw_alloc_complex(fNumUpsampled);
+  fForward = FFTWPlanner::makeForward(fNumPadded, fTimeBuffer, freqBuffer);
+  fBackward = FFTWPlanner::makeComplex(fNumUpsampled, sumBuffer, sumBuffer, FFTW_BACKWARD);
+  fFreqBuffer = freqBuffer;
+  fSumBuffer = sumBuffer;
+  fSummed.resize(fNumUpsampled);
+
+  makeMask();
+}
+
+
+
+CoherentSumKernel::~CoherentSumKernel(){
+
+  FFTWPlanner::destroy((fftw_plan) fForward);
+  FFTWPlanner::destroy((fftw_plan) fBackward);
+  fftw_free(fTimeBuffer);
+  fftw_free(fFreqBuffer);
+  fftw_free(fSumBuffer);
+}
+
+
+
+void CoherentSumKernel::addStopBand(Double_t minFreqMHz, Double_t maxFreqMHz){
+  fStopBandMins.push_back(minFreqMHz);
+  fStopBandMaxs.push_back(maxFreqMHz);
+  makeMask();
+}
+
+
+
+void CoherentSumKernel::clearStopBands(){
+  fStopBandMins.clear();
+  fStopBandMaxs.clear();
+  makeMask();
+}
+
+
+
+void CoherentSumKernel::makeMask(){
+
+  fMask.resize(2*fNumFreqs);
+  for(Int_t freqInd=0; freqInd < fNumFreqs; freqInd++){
+    const Double_t freqMHz = 1e3*fDeltaF*freqInd;
+    Double_t m = 1;
+    for(UInt_t i=0; i < fStopBandMins.size(); i++){
+      if(freqMHz >= fStopBandMins[i] && freqMHz < fStopBandMaxs[i]){
+	m = 0;
+      }
+    }
+    fMask[2*freqInd] = m;
+    fMask[2*freqInd+1] = m;
+  }
+}
+
+
+
+void CoherentSumKernel::setEvent(const UsefulAnitaEvent* usefulEvent){
+
+  // One time grid for every channel, so the calibrated relative timing is kept
+  Double_t t0 = 1e300;
+  for(Int_t polInd=0; polInd < AnitaPol::kNotAPol; polInd++){
+    for(Int_t ant=0; ant < NUM_SEAVEYS; ant++){
+      const Int_t chanIndex = AnitaGeomTool::getChanIndexFromAntPol(ant, (AnitaPol::AnitaPol_t) polInd);
+      if(usefulEvent->fNumPoints[chanIndex] > 0){
+	t0 = TMath::Min(t0, usefulEvent->fTimes[chanIndex][0]);
+      }
+    }
+  }
+
+  const Double_t* freqs = (const Double_t*) fFreqBuffer;
+  const Int_t numValues = 2*fNumFreqs;
+  for(Int_t polInd=0; polInd < AnitaPol::kNotAPol; polInd++){
+    for(Int_t ant=0; ant < NUM_SEAVEYS; ant++){
+      const Int_t chanIndex = AnitaGeomTool::getChanIndexFromAntPol(ant, (AnitaPol::AnitaPol_t) polInd);
+      const Int_t numPoints = usefulEvent->fNumPoints[chanIndex];
+      const Double_t* times = usefulEvent->fTimes[chanIndex];
+      const Double_t* volts = usefulEvent->fVolts[chanIndex];
+
+      // Linear interpolation, zero outside the waveform
+      memset(fTimeBuffer, 0, fNumPadded*sizeof(Double_t));
+      Int_t firstGood = fNumSamples;
+      Int_t lastGood = -1;
+      Int_t samp = 0;
+      for(Int_t i=0; i < fNumSamples && numPoints > 1; i++){
+	const Double_t t = t0 + i*fDeltaT;
+	if(t < times[0] || t > times[numPoints-1]){
+	  continue;
+	}
+	while(samp < numPoints - 2 && times[samp+1] < t){
+	  samp++;
+	}
+	const Double_t dt = times[samp+1] - times[samp];
+	const Double_t frac = dt > 0 ? (t - times[samp])/dt : 0;
+	fTimeBuffer[i] = volts[samp] + frac*(volts[samp+1] - volts[samp]);
+	firstGood = TMath::Min(firstGood, i);
+	lastGood = i;
+      }
+
+      // Zero mean, unit rms
+      const Int_t numGood = lastGood - firstGood + 1;
+      if(numGood > 1){
+	Double_t sum = 0;
+	Double_t sum2 = 0;
+	for(Int_t i=firstGood; i <= lastGood; i++){
+	  sum += fTimeBuffer[i];
+	  sum2 += fTimeBuffer[i]*fTimeBuffer[i];
+	}
+	const Double_t mean = sum/numGood;
+	const Double_t rms = TMath::Sqrt(TMath::Max(0., sum2/numGood - mean*mean));
+	const Double_t norm = rms > 0 ? 1./rms : 0;
+	for(Int_t i=firstGood; i <= lastGood; i++){
+	  fTimeBuffer[i] = (fTimeBuffer[i] - mean)*norm;
+	}
+      }
+
+      fftw_execute((fftw_plan) fForward);
+
+      // all the stop bands in one flat multiply
+      Double_t* spectrum = &fSpectra[polInd][ant][0];
+      for(Int_t i=0; i < numValues; i++){
+	spectrum[i] = freqs[i]*fMask[i];
+      }
+    }
+  }
+}
+
+
+
+void CoherentSumKernel::getPeakHilbertAndSnr(AnitaPol::AnitaPol_t pol, Double_t phiDeg, Double_t thetaDeg, Int_t maxDeltaPhiSect,
+					     Double_t& peakHilbert, Double_t& snr){
+
+  peakHilbert = 0;
+  snr = 0;
+
+  const Double_t phiWave = phiDeg*TMath::DegToRad();
+  const Double_t thetaWave = thetaDeg*TMath::DegToRad();
+  const Double_t maxDeltaPhiDeg = (maxDeltaPhiSect + 0.5)*360./NUM_PHI;
+
+  std::vector<Int_t> ants;
+  std::vector<Double_t> delays;
+  Double_t meanDelay = 0;
+  for(Int_t ant=0; ant < NUM_SEAVEYS; ant++){
+    if(TMath::Abs(RootTools::getDeltaAngleDeg(phiDeg, fPhi[pol][ant]*TMath::RadToDeg())) <= maxDeltaPhiDeg){
+      const Double_t delay = (fZ[pol][ant]*TMath::Sin(thetaWave)
+			      - fR[pol][ant]*TMath::Cos(phiWave - fPhi[pol][ant])*TMath::Cos(thetaWave))/speedOfLightMPerNs;
+      ants.push_back(ant);
+      delays.push_back(delay);
+      meanDelay += delay;
+    }
+  }
+  if(ants.size()==0){
+    return;
+  }
+  meanDelay /= ants.size();
+
+  // Analytic signal of the aligned sum: y_j(t + delay_j) is Y_j(f) exp(+i 2 pi f delay_j)
+  fftw_complex* sum = (fftw_complex*) fSumBuffer;
+  memset(sum, 0, fNumUpsampled*sizeof(fftw_complex));
+  const Double_t norm = 1./(ants.size()*fNumPadded);
+  for(UInt_t i=0; i < ants.size(); i++){
+    const Double_t* spectrum = &fSpectra[pol][ants[i]][0];
+    const Double_t dPhase = 2*TMath::Pi()*fDeltaF*(delays[i] - meanDelay);
+    const Double_t stepRe = TMath::Cos(dPhase);
+    const Double_t stepIm = TMath::Sin(dPhase);
+    Double_t phaseRe = 1;
+    Double_t phaseIm = 0;
+    for(Int_t freqInd=0; freqInd < fNumFreqs; freqInd++){
+      const Double_t re = spectrum[2*freqInd];
+      const Double_t im = spectrum[2*freqInd+1];
+      sum[freqInd][0] += re*phaseRe - im*phaseIm;
+      sum[freqInd][1] += re*phaseIm + im*phaseRe;
+
+      const Double_t nextRe = phaseRe*stepRe - phaseIm*stepIm;
+      phaseIm = phaseRe*stepIm + phaseIm*stepRe;
+      phaseRe = nextRe;
+    }
+  }
+  for(Int_t freqInd=0; freqInd < fNumFreqs; freqInd++){
+    // DC and Nyquist once, everything else twice (no negative frequencies)
+    const Double_t weight = (freqInd==0 || 2*freqInd==fNumPadded) ? norm : 2*norm;
+    sum[freqInd][0] *= weight;
+    sum[freqInd][1] *= weight;
+  }
+
+  fftw_execute((fftw_plan) fBackward);
+
+  // Only the unpadded part is real waveform
+  const Int_t numUseful = fNumUpsampled/2;
+  Double_t maxEnvelope2 = 0;
+  for(Int_t i=0; i < numUseful; i++){
+    fSummed[i] = sum[i][0];
+    maxEnvelope2 = TMath::Max(maxEnvelope2, sum[i][0]*sum[i][0] + sum[i][1]*sum[i][1]);
+  }
+  peakHilbert = TMath::Sqrt(maxEnvelope2);
+  snr = WaveformSnr::get(&fSummed[0], numUseful);
+}
@@ -0,0 +1,83 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Coherent sums and their Hilbert envelope peaks for many directions in one event, from spectra.
+             setEvent() interpolates each antenna's waveform onto an even grid (numSamples at deltaT, zero
+             padded to twice that), normalises it to zero mean and unit rms, applies the stop bands, and FFTs
+             it, once per event. Each direction is then a phase shifted sum of those spectra over the
+             antennas near phi. The positive frequencies are doubled to make the analytic signal, and it is
+             upsampled with one inverse FFT: the real part is the summed waveform and the magnitude is its
+             Hilbert envelope.
+             Delays are (z sin(theta) - r cos(phi - phiAnt) cos(theta))/c, positive theta is down, as in
+             CrossCorrelator. The SNR is WaveformSnr::get() of the summed waveform.
+             Not thread safe, use one per thread.
+*************************************************************************************************************** */
+
+#ifndef COHERENTSUMKERNEL_H
+#define COHERENTSUMKERNEL_H
+
+#include "Rtypes.h"
+#include "AnitaConventions.h"
+
+#include <vector>
+
+class UsefulAnitaEvent;
+
+class CoherentSumKernel {
+
+public:
+
+  CoherentSumKernel(Int_t numSamples = 256, Double_t deltaT = 1./2.6, Int_t upsampleFactor = 8);
+  ~CoherentSumKernel();
+
+  // Zero [minFreqMHz, maxFreqMHz) in every channel, call before setEvent
+  void addStopBand(Double_t minFreqMHz, Double_t maxFreqMHz);
+  void clearStopBands();
+
+  // Every antenna of both polarizations, once per event
+  void setEvent(const UsefulAnitaEvent* usefulEvent);
+
+  // Sum of the antennas within maxDeltaPhiSect phi-sectors of phiDeg, aligned for a plane wave from (phiDeg, thetaDeg)
+  void getPeakHilbertAndSnr(AnitaPol::AnitaPol_t pol, Double_t phiDeg, Double_t thetaDeg, Int_t maxDeltaPhiSect,
+			    Double_t& peakHilbert, Double_t& snr);
+
+private:
+
+  CoherentSumKernel(const CoherentSumKernel&);
+  CoherentSumKernel& operator=(const CoherentSumKernel&);
+
+  void makeMask();
+
+  Int_t fNumSamples;
+  Int_t fNumPadded; // length of the FFTs
+  Int_t fNumFreqs;
+  Int_t fNumUpsampled; // length of the inverse FFT
+  Double_t fDeltaT;
+  Double_t fDeltaF; // in GHz, so times in ns give cycles
+
+  std::vector<Double_t> fStopBandMins;
+  std::vector<Double_t> fStopBandMaxs;
+  std::vector<Double_t> fMask; // 0 or 1, twice per frequency bin to line up with re, im
+
+  // Antenna positions
+  Double_t fR[AnitaPol::kNotAPol][NUM_SEAVEYS];
+  Double_t fZ[AnitaPol::kNotAPol][NUM_SEAVEYS];
+  Double_t fPhi[AnitaPol::kNotAPol][NUM_SEAVEYS]; // radians
+
+  // This event's spectra, fNumFreqs complex (re, im pairs) per antenna
+  std::vector<Double_t> fSpectra[AnitaPol::kNotAPol][NUM_SEAVEYS];
+
+  // FFTW buffers and plans, as void* to keep fftw3.h out of the header
+  Double_t* fTimeBuffer;
+  void* fFreqBuffer;
+  void* fSumBuffer;
+  void* fForward;
+  void* fBackward;
+
+  std::vector<Double_t> fSummed; // real part of the upsampled sum
+};
+
+#endif
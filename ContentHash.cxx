@@ -0,0 +1,106 @@
+#include "ContentHash.h"
+
+#include <cstring>
+
+namespace {
+
+  inline ULong64_t rotl(ULong64_t x, Int_t r){
+    return (x << r) | (x >> (64 - r));
+  }
+
+  // finalization mix from MurmurHash3, forces all bits of the lane to avalanche
+  inline ULong64_t fmix(ULong64_t k){
+    k ^= k >> 33;
+    k *= 0xff51afd7ed558ccdull;
+    k ^= k >> 33;
+    k *= 0xc4ceb9fe1a85ec53ull;
+    k ^= k >> 33;
+    return k;
+  }
+
+  const ULong64_t kMul1 = 0x87c37b91114253d5ull;
+  const ULong64_t kMul2 = 0x4cf5ad432745937full;
+}
+
+
+ContentHash::ContentHash(){
+  fLane1 = 0x9e3779b97f4a7c15ull;
+  fLane2 = 0x6a09e667f3bcc909ull;
+  fNumBytes = 0;
+  fTail = 0;
+  fNumTailBytes = 0;
+}
+
+
+void ContentHash::mixWord(ULong64_t word){
+  fLane1 ^= rotl(word*kMul1, 31)*kMul2;
+  fLane1 = rotl(fLane1, 27) + fLane2;
+  fLane1 = fLane1*5 + 0x52dce729;
+
+  fLane2 ^= rotl(word*kMul2, 33)*kMul1;
+  fLane2 = rotl(fLane2, 31) + fLane1;
+  fLane2 = fLane2*5 + 0x38495ab5;
+}
+
+
+void ContentHash::add(const void* data, size_t numBytes){
+
+  const UChar_t* bytes = (const UChar_t*) data;
+  fNumBytes += numBytes;
+
+  // finish off any partial word from last time
+  while(fNumTailBytes > 0 && numBytes > 0){
+    fTail |= ((ULong64_t) *bytes) << (8*fNumTailBytes);
+    fNumTailBytes++;
+    bytes++;
+    numBytes--;
+    if(fNumTailBytes==8){
+      mixWord(fTail);
+      fTail = 0;
+      fNumTailBytes = 0;
+    }
+  }
+
+  while(numBytes >= 8){
+    ULong64_t word;
+    memcpy(&word, bytes, 8);
+    mixWord(word);
+    bytes += 8;
+    numBytes -= 8;
+  }
+
+  for(size_t i=0; i < numBytes; i++){
+    fTail |= ((ULong64_t) bytes[i]) << (8*fNumTailBytes);
+    fNumTailBytes++;
+  }
+}
+
+
+void ContentHash::digest(ULong64_t& hi, ULong64_t& lo) const {
+
+  ULong64_t h1 = fLane1;
+  ULong64_t h2 = fLane2;
+  if(fNumTailBytes > 0){
+    h1 ^= rotl(fTail*kMul1, 31)*kMul2;
+    h2 ^= rotl(fTail*kMul2, 33)*kMul1;
+  }
+
+  h1 ^= fNumBytes;
+  h2 ^= fNumBytes;
+  h1 += h2;
+  h2 += h1;
+  h1 = fmix(h1);
+  h2 = fmix(h2);
+  h1 += h2;
+  h2 += h1;
+
+  hi = h1;
+  lo = h2;
+}
+
+
+ULong64_t ContentHash::digest() const {
+  ULong64_t hi, lo;
+  digest(hi, lo);
+  return hi ^ lo;
+}
@@ -0,0 +1,46 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Fast, non-cryptographic 128-bit hash of arbitrary bytes.
+             For spotting changed data (baskets, header fields, event contents), not for security.
+*************************************************************************************************************** */
+
+#ifndef CONTENTHASH_H
+#define CONTENTHASH_H
+
+#include "Rtypes.h"
+#include <cstddef>
+
+class ContentHash {
+
+public:
+
+  ContentHash();
+
+  void add(const void* data, size_t numBytes);
+
+  template <class T> void add(const T& value){
+    add(&value, sizeof(T));
+  }
+
+  // the full 128 bits
+  void digest(ULong64_t& hi, ULong64_t& lo) const;
+
+  // 64 bits is plenty for comparing two things with each other
+  ULong64_t digest() const;
+
+private:
+
+  void mixWord(ULong64_t word);
+
+  ULong64_t fLane1;
+  ULong64_t fLane2;
+  ULong64_t fNumBytes;
+  ULong64_t fTail; // bytes that don't make up a full word yet
+  Int_t fNumTailBytes;
+};
+
+#endif
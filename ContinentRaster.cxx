@@ -0,0 +1,201 @@
+#include "ContinentRaster.h"
+#include "WorkPool.h"
+#include "GeolocationBatch.h"
+
+#include "RampdemReader.h"
+#include "TMath.h"
+
+#include <iostream>
+#include <fstream>
+#include <cstring>
+
+namespace {
+
+  const char fileMagic[8] = {'C', 'O', 'N', 'T', 'R', 'S', 'T', 'R'};
+  const UInt_t fileVersion = 1;
+
+  struct FileHeader {
+    char magic[8];
+    UInt_t version;
+    Int_t numCellsPerSide;
+    Double_t cellSize;
+    Double_t halfWidth;
+  };
+}
+
+
+
+ContinentRaster::ContinentRaster(){
+  fCellSize = 0;
+  fHalfWidth = 0;
+  fNumCellsPerSide = 0;
+}
+
+
+
+void ContinentRaster::build(Double_t cellSizeMetres, Double_t halfWidthMetres, Int_t numWorkers){
+
+  fCellSize = cellSizeMetres;
+  fHalfWidth = halfWidthMetres;
+  fNumCellsPerSide = TMath::CeilNint(2*fHalfWidth/fCellSize);
+  const Int_t n = fNumCellsPerSide;
+
+  std::cout << "Making " << n << "x" << n << " continent raster with "
+	    << 1e-3*fCellSize << " km cells" << std::endl;
+
+  // make sure RampdemReader has loaded its data before any threads ask it questions
+  GeolocationBatch::warmUp();
+
+  //*************************************************************************
+  // Sample the corners and centre of each cell
+  //*************************************************************************
+
+  std::vector<UChar_t> sampled(n*n, kMixed);
+  WorkPool::process(n, numWorkers, [&](Long64_t northingInd, Int_t workerInd){
+      (void) workerInd;
+      const Double_t offsets[5][2] = {{0, 0}, {1, 0}, {0, 1}, {1, 1}, {0.5, 0.5}};
+      for(Int_t eastingInd=0; eastingInd < n; eastingInd++){
+	Int_t numOn = 0;
+	for(Int_t sampleInd=0; sampleInd < 5; sampleInd++){
+	  Double_t easting = -fHalfWidth + (eastingInd + offsets[sampleInd][0])*fCellSize;
+	  Double_t northing = -fHalfWidth + (northingInd + offsets[sampleInd][1])*fCellSize;
+	  Double_t lon, lat;
+	  RampdemReader::EastingNorthingToLonLat(easting, northing, lon, lat);
+	  numOn += RampdemReader::isOnContinent(lon, lat) ? 1 : 0;
+	}
+	sampled[northingInd*n + eastingInd] = numOn==0 ? kOff : (numOn==5 ? kOn : kMixed);
+      }
+    });
+
+  //*************************************************************************
+  // Only trust cells whose neighbours all agree, so coastlines thinner than
+  // the sampling still get looked up properly
+  //*************************************************************************
+
+  fWords.assign((n*n + 31)/32, 0);
+  for(Int_t northingInd=0; northingInd < n; northingInd++){
+    for(Int_t eastingInd=0; eastingInd < n; eastingInd++){
+      ECellState state = (ECellState) sampled[northingInd*n + eastingInd];
+      if(northingInd==0 || eastingInd==0 || northingInd==n-1 || eastingInd==n-1){
+	state = kMixed;
+      }
+      for(Int_t dn=-1; dn <= 1 && state!=kMixed; dn++){
+	for(Int_t de=-1; de <= 1; de++){
+	  if(sampled[(northingInd+dn)*n + eastingInd+de]!=state){
+	    state = kMixed;
+	    break;
+	  }
+	}
+      }
+      setCellState(fWords, eastingInd, northingInd, state);
+    }
+  }
+}
+
+
+
+void ContinentRaster::setCellState(std::vector<ULong64_t>& words, Int_t eastingInd, Int_t northingInd, ECellState state) const {
+  const Long64_t cell = Long64_t(northingInd)*fNumCellsPerSide + eastingInd;
+  const Int_t shift = 2*(cell & 31);
+  words[cell >> 5] = (words[cell >> 5] & ~(3ULL << shift)) | (ULong64_t(state) << shift);
+}
+
+
+
+ContinentRaster::ECellState ContinentRaster::getCellState(Int_t eastingInd, Int_t northingInd) const {
+  if(eastingInd < 0 || northingInd < 0 || eastingInd >= fNumCellsPerSide || northingInd >= fNumCellsPerSide){
+    return kMixed;
+  }
+  const Long64_t cell = Long64_t(northingInd)*fNumCellsPerSide + eastingInd;
+  return (ECellState) ((fWords[cell >> 5] >> (2*(cell & 31))) & 3);
+}
+
+
+
+Bool_t ContinentRaster::isOnContinent(Double_t lon, Double_t lat) const {
+
+  Double_t easting, northing;
+  RampdemReader::LonLatToEastingNorthing(lon, lat, easting, northing);
+  const Int_t eastingInd = TMath::FloorNint((easting + fHalfWidth)/fCellSize);
+  const Int_t northingInd = TMath::FloorNint((northing + fHalfWidth)/fCellSize);
+
+  switch(getCellState(eastingInd, northingInd)){
+  case kOn:
+    return true;
+  case kOff:
+    return false;
+  default:
+    return RampdemReader::isOnContinent(lon, lat);
+  }
+}
+
+
+
+Int_t ContinentRaster::writeFile(const char* fileName) const {
+
+  std::ofstream outFile(fileName, std::ofstream::out | std::ofstream::binary);
+  if(!outFile.is_open()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open " << fileName << std::endl;
+    return 1;
+  }
+
+  FileHeader fileHeader;
+  memcpy(fileHeader.magic, fileMagic, sizeof(fileMagic));
+  fileHeader.version = fileVersion;
+  fileHeader.numCellsPerSide = fNumCellsPerSide;
+  fileHeader.cellSize = fCellSize;
+  fileHeader.halfWidth = fHalfWidth;
+
+  outFile.write((const char*) &fileHeader, sizeof(fileHeader));
+  outFile.write((const char*) &fWords[0], sizeof(ULong64_t)*fWords.size());
+  outFile.close();
+  if(outFile.fail()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", failed writing " << fileName << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+
+
+Int_t ContinentRaster::readFile(const char* fileName){
+
+  std::ifstream inFile(fileName, std::ifstream::in | std::ifstream::binary);
+  if(!inFile.is_open()){
+    return 1;
+  }
+
+  FileHeader fileHeader;
+  inFile.read((char*) &fileHeader, sizeof(fileHeader));
+  if(inFile.fail() || memcmp(fileHeader.magic, fileMagic, sizeof(fileMagic))!=0 || fileHeader.version!=fileVersion
+     || fileHeader.numCellsPerSide <= 0){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", " << fileName << " isn't a ContinentRaster file" << std::endl;
+    return 1;
+  }
+
+  const Long64_t numCells = Long64_t(fileHeader.numCellsPerSide)*fileHeader.numCellsPerSide;
+  std::vector<ULong64_t> words((numCells + 31)/32, 0);
+  inFile.read((char*) &words[0], sizeof(ULong64_t)*words.size());
+  if(inFile.fail()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", " << fileName << " is truncated" << std::endl;
+    return 1;
+  }
+
+  fNumCellsPerSide = fileHeader.numCellsPerSide;
+  fCellSize = fileHeader.cellSize;
+  fHalfWidth = fileHeader.halfWidth;
+  fWords.swap(words);
+
+  return 0;
+}
+
+
+
+Int_t ContinentRaster::loadOrBuild(const char* fileName, Int_t numWorkers){
+
+  if(readFile(fileName)==0){
+    return 0;
+  }
+  build(2000, 3.5e6, numWorkers);
+  return writeFile(fileName);
+}
@@ -0,0 +1,56 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             RampdemReader::isOnContinent on a grid of easting/northing cells, two bits per cell, cached to disk.
+             Cells that are entirely on or off the continent answer straight from the grid. Cells near the
+             coast (or with a neighbour near the coast) are marked mixed and fall through to RampdemReader.
+             The only way to get a different answer from RampdemReader::isOnContinent is a patch of land or
+             sea smaller than a cell, surrounded by cells that were sampled as entirely the other thing.
+             So it's only used when asked for (makeAnita3OverwrittenEventList --continent-raster).
+*************************************************************************************************************** */
+
+#ifndef CONTINENTRASTER_H
+#define CONTINENTRASTER_H
+
+#include "Rtypes.h"
+
+#include <vector>
+
+class ContinentRaster {
+
+public:
+
+  enum ECellState {
+    kOff = 0,
+    kOn = 1,
+    kMixed = 2
+  };
+
+  ContinentRaster();
+
+  // Grid centred on the pole with cells cellSizeMetres across, out to halfWidthMetres in easting and northing
+  void build(Double_t cellSizeMetres = 2000, Double_t halfWidthMetres = 3.5e6, Int_t numWorkers = 1);
+
+  Int_t writeFile(const char* fileName) const;
+  Int_t readFile(const char* fileName);
+  Int_t loadOrBuild(const char* fileName, Int_t numWorkers = 1);
+
+  Bool_t isOnContinent(Double_t lon, Double_t lat) const;
+
+  ECellState getCellState(Int_t eastingInd, Int_t northingInd) const;
+  Int_t getNumCellsPerSide() const {return fNumCellsPerSide;}
+
+private:
+
+  void setCellState(std::vector<ULong64_t>& words, Int_t eastingInd, Int_t northingInd, ECellState state) const;
+
+  Double_t fCellSize;
+  Double_t fHalfWidth;
+  Int_t fNumCellsPerSide;
+  std::vector<ULong64_t> fWords; // 32 cells per word
+};
+
+#endif
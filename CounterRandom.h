@@ -0,0 +1,57 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Counter based random numbers: the nth number of stream s is a hash of (seed, s, n), so there's no
+             state to share between threads. Giving each Monte Carlo trial its own stream makes the results
+             the same whatever the number of threads or the order trials run in.
+             Has the bits of the TRandom3 interface the blinding selection uses.
+*************************************************************************************************************** */
+
+#ifndef COUNTERRANDOM_H
+#define COUNTERRANDOM_H
+
+#include "Rtypes.h"
+#include "TMath.h"
+
+class CounterRandom {
+
+public:
+
+  CounterRandom(ULong64_t seed, ULong64_t stream)
+    : fKey(mix(mix(seed) ^ (stream + 0x632be59bd9b4e019ULL))), fCounter(0) {}
+
+  // uniform in [0, 1) with 53 bits
+  inline Double_t Rndm(){
+    return (mix(fKey + 0x9e3779b97f4a7c15ULL*(++fCounter)) >> 11)*(1.0/9007199254740992.0);
+  }
+
+  inline Double_t Uniform(Double_t x1, Double_t x2){
+    return x1 + (x2 - x1)*Rndm();
+  }
+
+  // Box-Muller, using one of the pair so there's still no state beyond the counter
+  inline Double_t Gaus(Double_t mean = 0, Double_t sigma = 1){
+    const Double_t u1 = 1 - Rndm();
+    const Double_t u2 = Rndm();
+    return mean + sigma*TMath::Sqrt(-2*TMath::Log(u1))*TMath::Cos(2*TMath::Pi()*u2);
+  }
+
+  ULong64_t getCounter() const {return fCounter;}
+
+private:
+
+  // splitmix64 finaliser
+  static inline ULong64_t mix(ULong64_t z){
+    z = (z ^ (z >> 30))*0xbf58476d1ce4e5b9ULL;
+    z = (z ^ (z >> 27))*0x94d049bb133111ebULL;
+    return z ^ (z >> 31);
+  }
+
+  ULong64_t fKey;
+  ULong64_t fCounter;
+};
+
+#endif
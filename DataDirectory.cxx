@@ -0,0 +1,54 @@
+#include "DataDirectory.h"
+
+#include "TSystem.h"
+
+#include <cstdlib>
+#include <cstring>
+
+TString DataDirectory::get(){
+  const char* dataDir = getenv("ANITA_ROOT_DATA");
+  return dataDir!=NULL ? TString(dataDir) : TString("~/UCL/ANITA/flight1415/root");
+}
+
+
+
+TString DataDirectory::getCacheDirectory(){
+  TString cacheDir;
+  const char* blindingCacheDir = getenv("BLINDING_CACHE_DIR");
+  const char* xdgCacheHome = getenv("XDG_CACHE_HOME");
+  if(blindingCacheDir!=NULL && strlen(blindingCacheDir) > 0){
+    cacheDir = blindingCacheDir;
+  }
+  else if(xdgCacheHome!=NULL && strlen(xdgCacheHome) > 0){
+    cacheDir = TString::Format("%s/blindingSetup", xdgCacheHome);
+  }
+  else{
+    cacheDir = "~/.cache/blindingSetup";
+  }
+  gSystem->ExpandPathName(cacheDir);
+  if(gSystem->AccessPathName(cacheDir)){
+    gSystem->mkdir(cacheDir, true);
+  }
+  return cacheDir;
+}
+
+
+
+TString DataDirectory::getRunFileName(Int_t run, const char* prefix, const char* suffix){
+  return getRunFileName(get(), run, prefix, suffix);
+}
+
+
+
+TString DataDirectory::getRunFileName(const char* dataDir, Int_t run, const char* prefix, const char* suffix){
+  return TString::Format("%s/run%d/%s%d%s", dataDir, run, prefix, run, suffix);
+}
+
+
+
+TString DataDirectory::getDecimatedEventNumbersFileName(Int_t firstRun, Int_t lastRun){
+  TString dataDir = get();
+  gSystem->ExpandPathName(dataDir);
+  return TString::Format("%s/decimatedEventNumbers_%d_%d_%08x.dat", getCacheDirectory().Data(),
+			 firstRun, lastRun, dataDir.Hash());
+}
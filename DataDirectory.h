@@ -0,0 +1,45 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Where the ANITA-3 ROOT files are: $ANITA_ROOT_DATA if it's set, otherwise
+             ~/UCL/ANITA/flight1415/root as before. Point ANITA_ROOT_DATA at the output of
+             makeSyntheticAnita3Data to run the programs that read runs without the flight data.
+
+             Caches made from the data (e.g. the realTime index) go in getCacheDirectory() instead, since the
+             data directory is often shared and read only: $BLINDING_CACHE_DIR, otherwise
+             $XDG_CACHE_HOME/blindingSetup or ~/.cache/blindingSetup.
+*************************************************************************************************************** */
+
+#ifndef DATADIRECTORY_H
+#define DATADIRECTORY_H
+
+#include "Rtypes.h"
+#include "TString.h"
+
+class DataDirectory {
+
+public:
+
+  static TString get();
+
+  // Made if it doesn't exist yet
+  static TString getCacheDirectory();
+
+  // <data dir>/run<run>/<prefix><run><suffix>
+  static TString getRunFileName(Int_t run, const char* prefix, const char* suffix = ".root");
+  static TString getRunFileName(const char* dataDir, Int_t run, const char* prefix, const char* suffix = ".root");
+
+  static TString getHeadFileName(Int_t run) {return getRunFileName(run, "timedHeadFile", "OfflineMask.root");}
+  static TString getGpsFileName(Int_t run) {return getRunFileName(run, "gpsEvent");}
+  static TString getCalEventFileName(Int_t run) {return getRunFileName(run, "calEventFile");}
+  static TString getDecimatedHeadFileName(Int_t run) {return getRunFileName(run, "decimatedHeadFile");}
+  static TString getRealTimeIndexFileName(Int_t run) {return TString::Format("%s/realTimeIndex%d.dat", getCacheDirectory().Data(), run);}
+
+  // EventNumberSet of the decimated eventNumbers, also named by the data directory, which might not be the only one using the cache
+  static TString getDecimatedEventNumbersFileName(Int_t firstRun, Int_t lastRun);
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include "EventNumberJoin.h"
+
+#include "TTree.h"
+#include "TBranch.h"
+
+#include <iostream>
+
+EventNumberJoin::EventNumberJoin(){
+  fNumMatched = 0;
+}
+
+
+
+Int_t EventNumberJoin::add(TTree* tree, std::function<UInt_t()> getEventNumber){
+
+  Cursor cursor;
+  cursor.tree = tree;
+  cursor.getEventNumber = getEventNumber;
+  cursor.numEntries = tree->GetEntries();
+  cursor.entry = -1;
+  cursor.eventNumber = 0;
+  cursor.treeNumber = -1;
+  cursor.keyBranch = NULL;
+  cursor.numMissing = 0;
+  cursor.numOutOfOrder = 0;
+  cursor.indexed = false;
+  fCursors.push_back(cursor);
+
+  return fCursors.size() - 1;
+}
+
+
+
+Bool_t EventNumberJoin::readEventNumber(Cursor& cursor){
+
+  const Long64_t localEntry = cursor.tree->LoadTree(cursor.entry);
+  if(localEntry < 0){
+    return false;
+  }
+  if(cursor.tree->GetTreeNumber()!=cursor.treeNumber){
+    cursor.treeNumber = cursor.tree->GetTreeNumber();
+    cursor.keyBranch = cursor.tree->GetTree()->GetBranch("eventNumber");
+  }
+
+  if(cursor.keyBranch!=NULL){
+    cursor.keyBranch->GetEntry(localEntry);
+  }
+  else{
+    cursor.tree->GetEntry(cursor.entry);
+  }
+  cursor.eventNumber = cursor.getEventNumber();
+  return true;
+}
+
+
+
+Bool_t EventNumberJoin::advance(Cursor& cursor){
+
+  if(cursor.entry + 1 >= cursor.numEntries){
+    return false;
+  }
+  cursor.entry++;
+
+  const UInt_t lastEventNumber = cursor.eventNumber;
+  if(!readEventNumber(cursor)){
+    cursor.entry--;
+    return false;
+  }
+
+  if(cursor.entry > 0 && cursor.eventNumber < lastEventNumber){
+    if(cursor.numOutOfOrder==0){
+      std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", " << cursor.tree->GetName() << " goes from eventNumber "
+		<< lastEventNumber << " to " << cursor.eventNumber << " at entry " << cursor.entry << std::endl;
+    }
+    cursor.numOutOfOrder++;
+  }
+  return true;
+}
+
+
+
+void EventNumberJoin::useIndex(Cursor& cursor){
+
+  if(cursor.indexed){
+    return;
+  }
+  std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", " << cursor.tree->GetName()
+	    << " isn't in eventNumber order, looking its events up with an eventNumber index from here on" << std::endl;
+  cursor.tree->BuildIndex("eventNumber");
+  cursor.indexed = true;
+}
+
+
+
+Bool_t EventNumberJoin::find(Cursor& cursor, UInt_t eventNumber, Bool_t repeat){
+
+  if(cursor.indexed){
+    // repeats share the entry the index gives
+    const Long64_t entry = cursor.tree->GetEntryNumberWithIndex(eventNumber);
+    if(entry < 0){
+      return false;
+    }
+    cursor.entry = entry;
+    cursor.eventNumber = eventNumber;
+    return true;
+  }
+
+  // A repeat of the first tree's last eventNumber takes this tree's next entry with it if there is one,
+  // so runs of equal eventNumbers are paired off in order. If this tree has fewer the last one is shared.
+  if(repeat && cursor.entry >= 0 && cursor.eventNumber==eventNumber){
+    const Long64_t lastEntry = cursor.entry;
+    const Long64_t numOutOfOrder = cursor.numOutOfOrder;
+    if(advance(cursor) && cursor.eventNumber!=eventNumber){
+      cursor.entry = lastEntry;
+      cursor.numOutOfOrder = numOutOfOrder; // it'll be seen again
+      readEventNumber(cursor);
+    }
+    return true;
+  }
+
+  // catch up
+  while(cursor.entry < 0 || cursor.eventNumber < eventNumber){
+    const Long64_t numOutOfOrder = cursor.numOutOfOrder;
+    if(!advance(cursor)){
+      break;
+    }
+    if(cursor.numOutOfOrder!=numOutOfOrder){
+      // anything from here on could be behind us, so stop merging this tree
+      useIndex(cursor);
+      return find(cursor, eventNumber, repeat);
+    }
+  }
+  return cursor.entry >= 0 && cursor.eventNumber==eventNumber;
+}
+
+
+
+Bool_t EventNumberJoin::next(){
+
+  if(fCursors.size()==0){
+    return false;
+  }
+
+  Cursor& driver = fCursors.at(0);
+  for(;;){
+    const Bool_t started = driver.entry >= 0;
+    const UInt_t lastEventNumber = driver.eventNumber;
+    const Long64_t numOutOfOrder = driver.numOutOfOrder;
+    if(!advance(driver)){
+      break;
+    }
+    const UInt_t eventNumber = driver.eventNumber;
+    const Bool_t repeat = started && eventNumber==lastEventNumber;
+
+    // the other trees may already be past this eventNumber
+    if(driver.numOutOfOrder!=numOutOfOrder){
+      for(UInt_t treeInd=1; treeInd < fCursors.size(); treeInd++){
+	useIndex(fCursors.at(treeInd));
+      }
+    }
+
+    Bool_t allMatch = true;
+    for(UInt_t treeInd=1; treeInd < fCursors.size(); treeInd++){
+      Cursor& cursor = fCursors.at(treeInd);
+      if(!find(cursor, eventNumber, repeat)){
+	cursor.numMissing++;
+	allMatch = false;
+      }
+    }
+
+    if(allMatch){
+      fNumMatched++;
+      return true;
+    }
+    driver.numMissing++;
+  }
+
+  return false;
+}
+
+
+
+Int_t EventNumberJoin::load(Int_t treeInd){
+  Cursor& cursor = fCursors.at(treeInd);
+  return cursor.tree->GetEntry(cursor.entry);
+}
+
+
+
+void EventNumberJoin::printSummary() const {
+
+  std::cout << "Matched " << fNumMatched << " eventNumbers";
+  if(fCursors.size() > 0){
+    std::cout << ", " << fCursors.at(0).numMissing << " entries of " << fCursors.at(0).tree->GetName()
+	      << " had no match in at least one other tree";
+  }
+  std::cout << std::endl;
+
+  for(UInt_t treeInd=1; treeInd < fCursors.size(); treeInd++){
+    const Cursor& cursor = fCursors.at(treeInd);
+    std::cout << "  " << cursor.tree->GetName() << " was missing " << cursor.numMissing << " eventNumbers";
+    if(cursor.numOutOfOrder > 0){
+      std::cout << " and went backwards " << cursor.numOutOfOrder << " times";
+    }
+    if(cursor.indexed){
+      std::cout << " (looked up with an eventNumber index)";
+    }
+    std::cout << std::endl;
+  }
+  if(fCursors.size() > 0 && fCursors.at(0).numOutOfOrder > 0){
+    std::cout << "  " << fCursors.at(0).tree->GetName() << " went backwards " << fCursors.at(0).numOutOfOrder
+	      << " times" << std::endl;
+  }
+}
@@ -0,0 +1,102 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Steps through trees that are all sorted by eventNumber (headTree, eventTree, adu5PatTree...)
+             together, stopping at each eventNumber of the first tree that every other tree also has.
+             It's a merge, so no TTreeIndex is built and every tree is read front to back.
+             If a tree's eventNumber goes backwards it can't be merged any more, so from then on that tree
+             (or every other tree, if it's the first) is looked up with BuildIndex("eventNumber") instead.
+             The step is only seen when it's read, so events between the jump forward and it can still be missed.
+             When the first tree repeats an eventNumber (e.g. the phi rotated copies of a WAIS pulse) each
+             repeat takes the next entry with that eventNumber in the other trees, if they have one,
+             otherwise they stay where they are and the entry is shared.
+
+             Set the branch addresses first, then give each tree a function returning the eventNumber
+             of what was just read. While looking for a match only the "eventNumber" branch is read if
+             there is one (the split header, or the UInt_t beside the pat in adu5PatTree, which then
+             needs its own address), otherwise the whole entry. load() reads the whole matching entry.
+
+             EventNumberJoin join;
+             join.add(headChain, [&](){return header->eventNumber;});
+             join.add(gpsChain, [&](){return gpsEventNumber;});
+             while(join.next()){
+               join.load(0);
+               ...
+             }
+
+             Events of the first tree missing from another tree are counted rather than printed.
+*************************************************************************************************************** */
+
+#ifndef EVENTNUMBERJOIN_H
+#define EVENTNUMBERJOIN_H
+
+#include "Rtypes.h"
+
+#include <vector>
+#include <functional>
+
+class TTree;
+class TBranch;
+
+class EventNumberJoin {
+
+public:
+
+  EventNumberJoin();
+
+  // The first tree added drives the join, returns the index of the tree for load() and the getters
+  Int_t add(TTree* tree, std::function<UInt_t()> getEventNumber);
+
+  // Moves every tree on to the next eventNumber they all have, false when the first tree runs out
+  Bool_t next();
+
+  // Reads all of the current entry of treeInd, returns the bytes read
+  Int_t load(Int_t treeInd);
+
+  UInt_t getEventNumber() const {return fCursors.at(0).eventNumber;}
+  Long64_t getEntry(Int_t treeInd) const {return fCursors.at(treeInd).entry;}
+
+  // Entries of the first tree with no match in treeInd
+  Long64_t getNumMissing(Int_t treeInd) const {return fCursors.at(treeInd).numMissing;}
+
+  // Times treeInd's eventNumber went backwards, after the first it's looked up with an index
+  Long64_t getNumOutOfOrder(Int_t treeInd) const {return fCursors.at(treeInd).numOutOfOrder;}
+
+  Long64_t getNumMatched() const {return fNumMatched;}
+
+  void printSummary() const;
+
+private:
+
+  struct Cursor {
+    TTree* tree;
+    std::function<UInt_t()> getEventNumber;
+    Long64_t numEntries;
+    Long64_t entry;
+    UInt_t eventNumber;
+    Int_t treeNumber; // of the TChain, to spot when keyBranch has to be found again
+    TBranch* keyBranch;
+    Long64_t numMissing;
+    Long64_t numOutOfOrder;
+    Bool_t indexed; // went backwards, so looked up with a TTreeIndex rather than merged
+  };
+
+  // Reads the eventNumber of cursor.entry
+  Bool_t readEventNumber(Cursor& cursor);
+
+  // Reads the eventNumber of cursor.entry + 1, false at the end of the tree
+  Bool_t advance(Cursor& cursor);
+
+  // Moves cursor to eventNumber if it has it, repeat is true if the first tree had it last time too
+  Bool_t find(Cursor& cursor, UInt_t eventNumber, Bool_t repeat);
+
+  void useIndex(Cursor& cursor);
+
+  std::vector<Cursor> fCursors;
+  Long64_t fNumMatched;
+};
+
+#endif
@@ -0,0 +1,214 @@
+#include "EventNumberSet.h"
+
+#include "TChain.h"
+#include "TString.h"
+#include "RawAnitaHeader.h"
+#include "ProgressBar.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+#include <cstdio>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+
+  const char fileMagic[8] = {'E', 'V', 'N', 'U', 'M', 'S', 'E', 'T'};
+  const UInt_t fileVersion = 1;
+
+  // 32 bytes, so the words after it stay 8 byte aligned in the mapped file
+  struct FileHeader {
+    char magic[8];
+    UInt_t version;
+    UInt_t firstEventNumber;
+    UInt_t numWords;
+    UInt_t numEventNumbers;
+    Long64_t numSourceEntries;
+  };
+}
+
+
+
+EventNumberSet::EventNumberSet(){
+  fMapped = NULL;
+  fMappedSize = 0;
+  clear();
+}
+
+
+
+EventNumberSet::~EventNumberSet(){
+  clear();
+}
+
+
+
+void EventNumberSet::clear(){
+  if(fMapped){
+    munmap(fMapped, fMappedSize);
+    fMapped = NULL;
+    fMappedSize = 0;
+  }
+  fOwnedWords.clear();
+  fFirstEventNumber = 0;
+  fNumWords = 0;
+  fNumEventNumbers = 0;
+  fNumSourceEntries = 0;
+  fWords = NULL;
+}
+
+
+
+void EventNumberSet::build(const std::vector<UInt_t>& eventNumbers){
+
+  clear();
+  if(eventNumbers.size()==0){
+    return;
+  }
+
+  const UInt_t minEventNumber = *std::min_element(eventNumbers.begin(), eventNumbers.end());
+  const UInt_t maxEventNumber = *std::max_element(eventNumbers.begin(), eventNumbers.end());
+
+  fFirstEventNumber = minEventNumber;
+  fNumWords = (maxEventNumber - minEventNumber)/64 + 1;
+  fOwnedWords.assign(fNumWords, 0);
+  for(UInt_t i=0; i < eventNumbers.size(); i++){
+    const UInt_t bit = eventNumbers.at(i) - fFirstEventNumber;
+    ULong64_t& word = fOwnedWords[bit >> 6];
+    const ULong64_t mask = 1ULL << (bit & 63);
+    if((word & mask)==0){
+      word |= mask;
+      fNumEventNumbers++;
+    }
+  }
+  fWords = &fOwnedWords[0];
+}
+
+
+
+void EventNumberSet::build(TChain* headChain){
+
+  RawAnitaHeader* header = NULL;
+  headChain->SetBranchAddress("header", &header);
+  if(headChain->GetBranch("eventNumber")){
+    headChain->SetBranchStatus("*", 0);
+    headChain->SetBranchStatus("eventNumber", 1);
+  }
+
+  const Long64_t nEntries = headChain->GetEntries();
+  std::vector<UInt_t> eventNumbers;
+  eventNumbers.reserve(nEntries);
+  ProgressBar p(nEntries);
+  for(Long64_t entry=0; entry < nEntries; entry++){
+    headChain->GetEntry(entry);
+    eventNumbers.push_back(header->eventNumber);
+    p.inc(entry, nEntries);
+  }
+
+  headChain->SetBranchStatus("*", 1);
+  headChain->ResetBranchAddresses();
+  delete header;
+
+  build(eventNumbers);
+  fNumSourceEntries = nEntries;
+}
+
+
+
+Int_t EventNumberSet::writeFile(const char* fileName) const {
+
+  // Written beside it and renamed over it, so other jobs with the old file mapped keep reading the old copy
+  // and a crash part way through leaves the old file rather than half a new one
+  const TString tempFileName = TString::Format("%s.%d.tmp", fileName, (Int_t) getpid());
+  std::ofstream outFile(tempFileName.Data(), std::ofstream::out | std::ofstream::binary);
+  if(!outFile.is_open()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open " << tempFileName << std::endl;
+    return 1;
+  }
+
+  FileHeader fileHeader;
+  memcpy(fileHeader.magic, fileMagic, sizeof(fileMagic));
+  fileHeader.version = fileVersion;
+  fileHeader.firstEventNumber = fFirstEventNumber;
+  fileHeader.numWords = fNumWords;
+  fileHeader.numEventNumbers = fNumEventNumbers;
+  fileHeader.numSourceEntries = fNumSourceEntries;
+
+  outFile.write((const char*) &fileHeader, sizeof(fileHeader));
+  if(fNumWords > 0){
+    outFile.write((const char*) fWords, sizeof(ULong64_t)*fNumWords);
+  }
+  outFile.close();
+  if(outFile.fail()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", failed writing " << tempFileName << std::endl;
+    unlink(tempFileName.Data());
+    return 1;
+  }
+  if(rename(tempFileName.Data(), fileName)!=0){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to rename " << tempFileName << " to " << fileName << std::endl;
+    unlink(tempFileName.Data());
+    return 1;
+  }
+  return 0;
+}
+
+
+
+Int_t EventNumberSet::readFile(const char* fileName){
+
+  clear();
+
+  int fd = open(fileName, O_RDONLY);
+  if(fd < 0){
+    return 1;
+  }
+  struct stat fileStat;
+  if(fstat(fd, &fileStat)!=0 || (size_t) fileStat.st_size < sizeof(FileHeader)){
+    close(fd);
+    return 1;
+  }
+
+  void* mapped = mmap(NULL, fileStat.st_size, PROT_READ, MAP_SHARED, fd, 0);
+  close(fd); // the mapping stays valid
+  if(mapped==MAP_FAILED){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to map " << fileName << std::endl;
+    return 1;
+  }
+
+  const FileHeader* fileHeader = (const FileHeader*) mapped;
+  if(memcmp(fileHeader->magic, fileMagic, sizeof(fileMagic))!=0 || fileHeader->version!=fileVersion
+     || (size_t) fileStat.st_size != sizeof(FileHeader) + sizeof(ULong64_t)*fileHeader->numWords){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", " << fileName << " isn't an EventNumberSet file" << std::endl;
+    munmap(mapped, fileStat.st_size);
+    return 1;
+  }
+
+  fMapped = mapped;
+  fMappedSize = fileStat.st_size;
+  fFirstEventNumber = fileHeader->firstEventNumber;
+  fNumWords = fileHeader->numWords;
+  fNumEventNumbers = fileHeader->numEventNumbers;
+  fNumSourceEntries = fileHeader->numSourceEntries;
+  fWords = (const ULong64_t*) ((const char*) mapped + sizeof(FileHeader));
+
+  return 0;
+}
+
+
+
+Int_t EventNumberSet::loadOrBuild(const char* fileName, TChain* headChain){
+
+  const Long64_t nEntries = headChain->GetEntries();
+  if(readFile(fileName)==0 && fNumSourceEntries==nEntries){
+    return 0;
+  }
+
+  std::cout << "Making " << fileName << " from " << nEntries << " headers" << std::endl;
+  build(headChain);
+  return writeFile(fileName);
+}
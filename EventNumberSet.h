@@ -0,0 +1,73 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             A set of eventNumbers stored as one bit per eventNumber between the smallest and largest.
+             For the decimated data set that's about 11 MB for the whole flight, and asking whether an
+             eventNumber is in it is a single bit test.
+
+             Saved to a small binary file which is memory mapped when read back, so tools that need to skip
+             the decimated data set don't have to build a TTreeIndex over every decimated head file.
+             The file is written under a temporary name and renamed into place, never rewritten in place,
+             since other jobs may have it mapped.
+*************************************************************************************************************** */
+
+#ifndef EVENTNUMBERSET_H
+#define EVENTNUMBERSET_H
+
+#include "Rtypes.h"
+
+#include <vector>
+
+class TChain;
+
+class EventNumberSet {
+
+public:
+
+  EventNumberSet();
+  ~EventNumberSet();
+
+  void build(const std::vector<UInt_t>& eventNumbers);
+
+  // Every eventNumber in a head chain, only reads the eventNumber branch if the header is split.
+  void build(TChain* headChain);
+
+  Int_t writeFile(const char* fileName) const;
+  Int_t readFile(const char* fileName);
+
+  // Reads fileName if it was made from a chain with the same number of entries,
+  // otherwise builds the set from the chain and (re)writes fileName.
+  Int_t loadOrBuild(const char* fileName, TChain* headChain);
+
+  inline Bool_t contains(UInt_t eventNumber) const {
+    const UInt_t bit = eventNumber - fFirstEventNumber; // wraps round if eventNumber < fFirstEventNumber
+    if(bit >= 64*(ULong64_t) fNumWords){
+      return false;
+    }
+    return (fWords[bit >> 6] >> (bit & 63)) & 1;
+  }
+
+  UInt_t size() const {return fNumEventNumbers;}
+
+private:
+
+  EventNumberSet(const EventNumberSet&);
+  EventNumberSet& operator=(const EventNumberSet&);
+
+  void clear();
+
+  UInt_t fFirstEventNumber;
+  UInt_t fNumWords;
+  UInt_t fNumEventNumbers;
+  Long64_t fNumSourceEntries; // entries in the chain the set was made from, to spot stale files
+  const ULong64_t* fWords; // points into fOwnedWords or the mapped file
+
+  std::vector<ULong64_t> fOwnedWords;
+  void* fMapped;
+  size_t fMappedSize;
+};
+
+#endif
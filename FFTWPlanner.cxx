@@ -0,0 +1,39 @@
+#include "FFTWPlanner.h"
+
+
+
+std::mutex& FFTWPlanner::getMutex(){
+  static std::mutex plannerMutex;
+  return plannerMutex;
+}
+
+
+
+fftw_plan FFTWPlanner::makeForward(Int_t numPoints, Double_t* in, fftw_complex* out){
+  std::lock_guard<std::mutex> lock(getMutex());
+  return fftw_plan_dft_r2c_1d(numPoints, in, out, FFTW_MEASURE);
+}
+
+
+
+fftw_plan FFTWPlanner::makeBackward(Int_t numPoints, fftw_complex* in, Double_t* out){
+  std::lock_guard<std::mutex> lock(getMutex());
+  return fftw_plan_dft_c2r_1d(numPoints, in, out, FFTW_MEASURE);
+}
+
+
+
+fftw_plan FFTWPlanner::makeComplex(Int_t numPoints, fftw_complex* in, fftw_complex* out, Int_t sign){
+  std::lock_guard<std::mutex> lock(getMutex());
+  return fftw_plan_dft_1d(numPoints, in, out, sign, FFTW_MEASURE);
+}
+
+
+
+void FFTWPlanner::destroy(fftw_plan plan){
+  if(plan==NULL){
+    return;
+  }
+  std::lock_guard<std::mutex> lock(getMutex());
+  fftw_destroy_plan(plan);
+}
@@ -0,0 +1,41 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             The one lock for the FFTW planner. FFTW's planner isn't thread safe (executing plans is), and it's
+             shared by everything in the process: FrequencyDomainFilter, HilbertEnvelope and CoherentSumKernel
+             here, and FFTtools/FancyFFTs inside CrossCorrelator. So anything that can make or destroy a plan
+             holds getMutex() while it does.
+             The plans here are made through makeForward()/makeBackward()/makeComplex()/destroy(), which take it.
+             The libraries plan on first use of each length, so any FFTtools call is made with getMutex() held.
+             FancyFFTs also keeps static buffers per thread index, shared by every CrossCorrelator, so a
+             CrossCorrelator is only used from one thread and reconstruction and scanWaisPulseSnr split over processes.
+*************************************************************************************************************** */
+
+#ifndef FFTWPLANNER_H
+#define FFTWPLANNER_H
+
+#include "Rtypes.h"
+
+#include <fftw3.h>
+
+#include <mutex>
+
+class FFTWPlanner {
+
+public:
+
+  static std::mutex& getMutex();
+
+  // FFTW_MEASURE plans, made with getMutex() held
+  static fftw_plan makeForward(Int_t numPoints, Double_t* in, fftw_complex* out);
+  static fftw_plan makeBackward(Int_t numPoints, fftw_complex* in, Double_t* out);
+  static fftw_plan makeComplex(Int_t numPoints, fftw_complex* in, fftw_complex* out, Int_t sign);
+
+  // NULL is fine, with getMutex() held
+  static void destroy(fftw_plan plan);
+};
+
+#endif
@@ -0,0 +1,138 @@
+#include "FlightTrack.h"
+
+#include "TFile.h"
+#include "TChain.h"
+#include "TNamed.h"
+#include "TGraphAntarctica.h"
+
+#include "Adu5Pat.h"
+
+#include <iostream>
+
+FlightTrack::FlightTrack(){
+  fNumSourceEntries = 0;
+}
+
+
+
+void FlightTrack::build(TChain* gpsChain, Int_t numPoints){
+
+  fRealTime.clear();
+  fLongitude.clear();
+  fLatitude.clear();
+  fAltitude.clear();
+
+  Adu5Pat* pat = NULL;
+  gpsChain->SetBranchAddress("pat", &pat);
+
+  fNumSourceEntries = gpsChain->GetEntries();
+  Long64_t selectEvery = numPoints > 0 ? fNumSourceEntries/numPoints : 1;
+  if(selectEvery < 1){
+    selectEvery = 1;
+  }
+  for(Long64_t entry=0; entry < fNumSourceEntries; entry += selectEvery){
+    gpsChain->GetEntry(entry);
+    fRealTime.push_back(pat->realTime);
+    fLongitude.push_back(pat->longitude);
+    fLatitude.push_back(pat->latitude);
+    fAltitude.push_back(pat->altitude);
+  }
+
+  gpsChain->ResetBranchAddresses();
+  delete pat;
+}
+
+
+
+Int_t FlightTrack::writeFile(const char* fileName) const {
+
+  TFile* outFile = new TFile(fileName, "recreate");
+  if(outFile->IsZombie()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open " << fileName << std::endl;
+    delete outFile;
+    return 1;
+  }
+
+  TTree* trackTree = new TTree("flightTrackTree", "Downsampled ANITA flight path");
+  UInt_t realTime;
+  Double_t longitude, latitude, altitude;
+  trackTree->Branch("realTime", &realTime);
+  trackTree->Branch("longitude", &longitude);
+  trackTree->Branch("latitude", &latitude);
+  trackTree->Branch("altitude", &altitude);
+  for(UInt_t i=0; i < size(); i++){
+    realTime = fRealTime.at(i);
+    longitude = fLongitude.at(i);
+    latitude = fLatitude.at(i);
+    altitude = fAltitude.at(i);
+    trackTree->Fill();
+  }
+
+  // so stale files can be spotted without opening the gps files
+  TNamed numSourceEntries("numSourceEntries", TString::Format("%lld", fNumSourceEntries).Data());
+  numSourceEntries.Write();
+
+  outFile->Write();
+  outFile->Close();
+  delete outFile;
+  return 0;
+}
+
+
+
+Int_t FlightTrack::readFile(const char* fileName){
+
+  TFile* inFile = TFile::Open(fileName);
+  TTree* trackTree = inFile ? (TTree*) inFile->Get("flightTrackTree") : NULL;
+  TNamed* numSourceEntries = inFile ? (TNamed*) inFile->Get("numSourceEntries") : NULL;
+  if(trackTree==NULL || numSourceEntries==NULL){
+    delete inFile;
+    return 1;
+  }
+
+  UInt_t realTime;
+  Double_t longitude, latitude, altitude;
+  trackTree->SetBranchAddress("realTime", &realTime);
+  trackTree->SetBranchAddress("longitude", &longitude);
+  trackTree->SetBranchAddress("latitude", &latitude);
+  trackTree->SetBranchAddress("altitude", &altitude);
+
+  fNumSourceEntries = TString(numSourceEntries->GetTitle()).Atoll();
+  const Long64_t nEntries = trackTree->GetEntries();
+  fRealTime.resize(nEntries);
+  fLongitude.resize(nEntries);
+  fLatitude.resize(nEntries);
+  fAltitude.resize(nEntries);
+  for(Long64_t entry=0; entry < nEntries; entry++){
+    trackTree->GetEntry(entry);
+    fRealTime[entry] = realTime;
+    fLongitude[entry] = longitude;
+    fLatitude[entry] = latitude;
+    fAltitude[entry] = altitude;
+  }
+
+  inFile->Close();
+  delete inFile;
+  return 0;
+}
+
+
+
+Int_t FlightTrack::loadOrBuild(const char* fileName, TChain* gpsChain, Int_t numPoints){
+
+  if(readFile(fileName)==0 && fNumSourceEntries==gpsChain->GetEntries()){
+    return 0;
+  }
+  build(gpsChain, numPoints);
+  return writeFile(fileName);
+}
+
+
+
+TGraphAntarctica* FlightTrack::makeGraph() const {
+  TGraphAntarctica* gr = new TGraphAntarctica();
+  for(UInt_t i=0; i < size(); i++){
+    gr->SetPoint(i, fLongitude.at(i), fLatitude.at(i));
+  }
+  return gr;
+}
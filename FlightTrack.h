@@ -0,0 +1,54 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             A few thousand points along the flight path (every Nth gps entry), for drawing on maps.
+             Reads only the entries it keeps rather than drawing the whole gps chain with a TCut,
+             and is saved in a small ROOT file (flightTrackTree) that other plotting scripts can use too.
+*************************************************************************************************************** */
+
+#ifndef FLIGHTTRACK_H
+#define FLIGHTTRACK_H
+
+#include "Rtypes.h"
+
+#include <vector>
+
+class TChain;
+class TGraphAntarctica;
+
+class FlightTrack {
+
+public:
+
+  FlightTrack();
+
+  // Keeps entries 0, N, 2N... with N = entries/numPoints, like a "(Entry$ % N)==0" cut
+  void build(TChain* gpsChain, Int_t numPoints = 5000);
+
+  Int_t writeFile(const char* fileName) const;
+  Int_t readFile(const char* fileName);
+
+  // Reads fileName if it was made from a chain with the same number of entries, otherwise builds and saves it
+  Int_t loadOrBuild(const char* fileName, TChain* gpsChain, Int_t numPoints = 5000);
+
+  TGraphAntarctica* makeGraph() const;
+
+  size_t size() const {return fLongitude.size();}
+  UInt_t getRealTime(Int_t i) const {return fRealTime.at(i);}
+  Double_t getLongitude(Int_t i) const {return fLongitude.at(i);}
+  Double_t getLatitude(Int_t i) const {return fLatitude.at(i);}
+  Double_t getAltitude(Int_t i) const {return fAltitude.at(i);}
+
+private:
+
+  Long64_t fNumSourceEntries;
+  std::vector<UInt_t> fRealTime;
+  std::vector<Double_t> fLongitude;
+  std::vector<Double_t> fLatitude;
+  std::vector<Double_t> fAltitude;
+};
+
+#endif
@@ -0,0 +1,192 @@
+#include "FrequencyDomainFilter.h"
+#include "FFTWPlanner.h"
+
+#include "UsefulAnitaEvent.h"
+#include "AnitaGeomTool.h"
+
+#include <fftw3.h>
+
+#include <cstring>
+
+struct FrequencyDomainFilter::LengthCache {
+  Int_t numPoints;
+  Int_t numFreqs;
+  Double_t* timeBuffer;
+  fftw_complex* freqBuffer;
+  fftw_plan forward;
+  fftw_plan backward;
+  std::vector<Double_t> mask; // 0 or 1/numPoints, twice per bin to line up with re, im
+};
+
+
+
+const std::vector<Int_t>& FrequencyDomainFilter::getAntennaChanIndices(){
+  static const std::vector<Int_t> chanIndices = [](){
+    std::vector<Int_t> antennaChans;
+    for(Int_t polInd=0; polInd < AnitaPol::kNotAPol; polInd++){
+      for(Int_t ant=0; ant < NUM_SEAVEYS; ant++){
+	antennaChans.push_back(AnitaGeomTool::getChanIndexFromAntPol(ant, (AnitaPol::AnitaPol_t) polInd));
+      }
+    }
+    return antennaChans;
+  }();
+  return chanIndices;
+}
+
+
+
+FrequencyDomainFilter::FrequencyDomainFilter(Double_t deltaT){
+  fDeltaT = deltaT;
+  fLastNumPoints = -1;
+  fLastCache = NULL;
+}
+
+
+
+FrequencyDomainFilter::~FrequencyDomainFilter(){
+  clearCaches();
+}
+
+
+
+void FrequencyDomainFilter::clearCaches(){
+
+  for(std::map<Int_t, LengthCache*>::iterator it = fCaches.begin(); it != fCaches.end(); ++it){
+    LengthCache* cache = it->second;
+    FFTWPlanner::destroy(cache->forward);
+    FFTWPlanner::destroy(cache->backward);
+    fftw_free(cache->timeBuffer);
+    fftw_free(cache->freqBuffer);
+    delete cache;
+  }
+  fCaches.clear();
+  fLastNumPoints = -1;
+  fLastCache = NULL;
+}
+
+
+
+void FrequencyDomainFilter::addStopBand(Double_t minFreqMHz, Double_t maxFreqMHz){
+  fStopBandMins.push_back(minFreqMHz);
+  fStopBandMaxs.push_back(maxFreqMHz);
+  updateMasks();
+}
+
+
+
+void FrequencyDomainFilter::clearStopBands(){
+  fStopBandMins.clear();
+  fStopBandMaxs.clear();
+  updateMasks();
+}
+
+
+
+void FrequencyDomainFilter::updateMasks(){
+  // the plans and buffers don't depend on the stop bands, so keep them
+  for(std::map<Int_t, LengthCache*>::iterator it = fCaches.begin(); it != fCaches.end(); ++it){
+    makeMask(it->second);
+  }
+}
+
+
+
+void FrequencyDomainFilter::makeMask(LengthCache* cache) const {
+
+  // Same frequencies as the old 1e3/(deltaT*numPoints) loop, with the inverse FFT normalisation folded in
+  const Double_t deltaF = 1e3/(fDeltaT*cache->numPoints);
+  cache->mask.resize(2*cache->numFreqs);
+  for(Int_t freqInd=0; freqInd < cache->numFreqs; freqInd++){
+    const Double_t m = passes(deltaF*freqInd) ? 1./cache->numPoints : 0;
+    cache->mask[2*freqInd] = m;
+    cache->mask[2*freqInd+1] = m;
+  }
+}
+
+
+
+void FrequencyDomainFilter::addLowPass(Double_t maxFreqMHz){
+  addStopBand(maxFreqMHz, 1e300);
+}
+
+
+
+Bool_t FrequencyDomainFilter::passes(Double_t freqMHz) const {
+  for(UInt_t i=0; i < fStopBandMins.size(); i++){
+    if(freqMHz >= fStopBandMins[i] && freqMHz < fStopBandMaxs[i]){
+      return false;
+    }
+  }
+  return true;
+}
+
+
+
+FrequencyDomainFilter::LengthCache* FrequencyDomainFilter::getCache(Int_t numPoints){
+
+  if(numPoints==fLastNumPoints){
+    return fLastCache;
+  }
+
+  std::map<Int_t, LengthCache*>::iterator it = fCaches.find(numPoints);
+  LengthCache* cache = NULL;
+  if(it != fCaches.end()){
+    cache = it->second;
+  }
+  else{
+    cache = new LengthCache();
+    cache->numPoints = numPoints;
+    cache->numFreqs = numPoints/2 + 1;
+    cache->timeBuffer = fftw_alloc_real(numPoints);
+    cache->freqBuffer = fftw_alloc_complex(cache->numFreqs);
+    cache->forward = FFTWPlanner::makeForward(numPoints, cache->timeBuffer, cache->freqBuffer);
+    cache->backward = FFTWPlanner::makeBackward(numPoints, cache->freqBuffer, cache->timeBuffer);
+    makeMask(cache);
+    fCaches[numPoints] = cache;
+  }
+
+  fLastNumPoints = numPoints;
+  fLastCache = cache;
+  return cache;
+}
+
+
+
+void FrequencyDomainFilter::apply(Double_t* volts, Int_t numPoints){
+
+  if(numPoints <= 0){
+    return;
+  }
+  LengthCache* cache = getCache(numPoints);
+
+  memcpy(cache->timeBuffer, volts, numPoints*sizeof(Double_t));
+  fftw_execute(cache->forward);
+
+  // fftw_complex is two doubles, so every band is a single flat multiply the compiler can vectorise
+  const Double_t* mask = &cache->mask[0];
+  Double_t* freqs = (Double_t*) cache->freqBuffer;
+  const Int_t numValues = 2*cache->numFreqs;
+  for(Int_t i=0; i < numValues; i++){
+    freqs[i] *= mask[i];
+  }
+
+  fftw_execute(cache->backward);
+  memcpy(volts, cache->timeBuffer, numPoints*sizeof(Double_t));
+}
+
+
+
+void FrequencyDomainFilter::apply(UsefulAnitaEvent* usefulEvent, const std::vector<Int_t>& chanIndices){
+  for(UInt_t i=0; i < chanIndices.size(); i++){
+    const Int_t chanIndex = chanIndices[i];
+    apply(usefulEvent->fVolts[chanIndex], usefulEvent->fNumPoints[chanIndex]);
+  }
+}
+
+
+
+void FrequencyDomainFilter::apply(const std::vector<UsefulAnitaEvent*>& usefulEvents, const std::vector<Int_t>& chanIndices){
+  for(UInt_t eventInd=0; eventInd < usefulEvents.size(); eventInd++){
+    apply(usefulEvents[eventInd], chanIndices);
+  }
+}
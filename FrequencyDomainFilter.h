@@ -0,0 +1,73 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Zeroes bands of frequencies in waveforms, e.g. everything above 700 MHz for ALFA.
+             Keeps an FFTW plan pair, aligned buffers and the mask (with the 1/N normalisation folded in)
+             for each waveform length it has seen, so after the first waveform of each length nothing is
+             allocated or planned. All the stop bands are compiled into that one mask, and changing them
+             only remakes the masks. Not thread safe, use one per thread (the plans are made through FFTWPlanner).
+*************************************************************************************************************** */
+
+#ifndef FREQUENCYDOMAINFILTER_H
+#define FREQUENCYDOMAINFILTER_H
+
+#include "Rtypes.h"
+
+#include <vector>
+#include <map>
+
+class UsefulAnitaEvent;
+
+class FrequencyDomainFilter {
+
+public:
+
+  // deltaT in ns, ANITA-3 waveforms are interpolated to 1/2.6 ns
+  explicit FrequencyDomainFilter(Double_t deltaT = 1./2.6);
+  ~FrequencyDomainFilter();
+
+  // Zero frequencies in [minFreqMHz, maxFreqMHz)
+  void addStopBand(Double_t minFreqMHz, Double_t maxFreqMHz);
+
+  // Zero everything at or above maxFreqMHz
+  void addLowPass(Double_t maxFreqMHz);
+
+  // Pass everything again, e.g. before trying another NotchFilterBank (the FFTW plans are kept)
+  void clearStopBands();
+
+  // Filters numPoints samples of volts in place
+  void apply(Double_t* volts, Int_t numPoints);
+
+  // Each chanIndex of each event, in one go
+  void apply(UsefulAnitaEvent* usefulEvent, const std::vector<Int_t>& chanIndices);
+  void apply(const std::vector<UsefulAnitaEvent*>& usefulEvents, const std::vector<Int_t>& chanIndices);
+
+  // Every antenna channel (not the clocks), for filtering whole events
+  static const std::vector<Int_t>& getAntennaChanIndices();
+
+  // Is freqMHz passed by the filter?
+  Bool_t passes(Double_t freqMHz) const;
+
+private:
+
+  FrequencyDomainFilter(const FrequencyDomainFilter&);
+  FrequencyDomainFilter& operator=(const FrequencyDomainFilter&);
+
+  struct LengthCache;
+  LengthCache* getCache(Int_t numPoints);
+  void clearCaches();
+  void updateMasks();
+  void makeMask(LengthCache* cache) const;
+
+  Double_t fDeltaT;
+  std::vector<Double_t> fStopBandMins;
+  std::vector<Double_t> fStopBandMaxs;
+  std::map<Int_t, LengthCache*> fCaches;
+  Int_t fLastNumPoints;
+  LengthCache* fLastCache; // most waveforms are the same length as the one before
+};
+
+#endif
@@ -0,0 +1,110 @@
+#include "GeolocationBatch.h"
+#include "MinBiasCandidatePool.h"
+#include "ContinentRaster.h"
+#include "WorkPool.h"
+
+#include "UsefulAdu5Pat.h"
+#include "RampdemReader.h"
+#include "AnitaGeomTool.h"
+#include "RootTools.h"
+#include "TMath.h"
+
+#include <algorithm>
+
+namespace {
+  // candidates per task handed to a worker, small enough to balance, big enough that claiming one is free
+  const Long64_t chunkSize = 256;
+}
+
+
+
+GeolocationBatch::GeolocationBatch(const MinBiasCandidatePool& pool, const ContinentRaster* raster, Int_t numWorkers)
+  : fPool(pool), fRaster(raster), fNumWorkers(numWorkers) {
+  warmUp();
+}
+
+
+
+void GeolocationBatch::warmUp(){
+
+  AnitaGeomTool::Instance();
+
+  Double_t easting, northing, lon, lat;
+  RampdemReader::LonLatToEastingNorthing(0, -90, easting, northing);
+  RampdemReader::EastingNorthingToLonLat(easting, northing, lon, lat);
+  RampdemReader::isOnContinent(0, -90);
+  RampdemReader::SurfaceAboveGeoid(0, -90);
+
+  // everything getSourceLonAndLatAtAlt touches, looking down from above the pole
+  Adu5Pat pat;
+  pat.latitude = -90;
+  pat.longitude = 0;
+  pat.altitude = 37000;
+  pat.heading = 0;
+  pat.pitch = 0;
+  pat.roll = 0;
+  UsefulAdu5Pat usefulPat(&pat);
+  Double_t sourceLon, sourceLat, sourceAltitude;
+  usefulPat.getSourceLonAndLatAtAlt(0, 45*TMath::DegToRad(), sourceLon, sourceLat, sourceAltitude);
+  usefulPat.getDistanceFromSource(sourceLat, sourceLon, sourceAltitude);
+}
+
+
+
+void GeolocationBatch::evaluateOne(Int_t candidateInd, Double_t phiDeg, Double_t thetaDeg, Result& result) const {
+
+  result.retVal = 0;
+  result.sourceLon = -9999;
+  result.sourceLat = -9999;
+  result.sourceAltitude = -9999;
+  result.eventBearing = -9999;
+  result.onContinent = false;
+  result.southFacing = false;
+  if(candidateInd < 0){
+    return;
+  }
+
+  Adu5Pat pat;
+  fPool.getPat(candidateInd, &pat);
+  UsefulAdu5Pat usefulPat(&pat);
+
+  Double_t phiWave = phiDeg*TMath::DegToRad();
+  Double_t thetaWave = thetaDeg*TMath::DegToRad();
+  result.retVal = usefulPat.getSourceLonAndLatAtAlt(phiWave, -thetaWave, result.sourceLon, result.sourceLat, result.sourceAltitude);
+  if(result.retVal==1 && fRaster!=NULL){
+    result.onContinent = fRaster->isOnContinent(result.sourceLon, result.sourceLat);
+  }
+  else if(result.retVal==1){
+    result.onContinent = RampdemReader::isOnContinent(result.sourceLon, result.sourceLat);
+  }
+
+  result.eventBearing = RootTools::getDeltaAngleDeg(pat.heading, phiDeg);
+  result.southFacing = TMath::Abs(result.eventBearing) > 135;
+}
+
+
+
+void GeolocationBatch::evaluate(const std::vector<Int_t>& candidateInds, Double_t phiDeg, Double_t thetaDeg, std::vector<Result>& results) const {
+
+  const Long64_t n = candidateInds.size();
+  results.resize(n);
+  const Long64_t numChunks = (n + chunkSize - 1)/chunkSize;
+
+  WorkPool::process(numChunks, fNumWorkers, [&](Long64_t chunk, Int_t workerInd){
+      (void) workerInd;
+      const Long64_t last = std::min(n, (chunk+1)*chunkSize);
+      for(Long64_t i=chunk*chunkSize; i < last; i++){
+	evaluateOne(candidateInds[i], phiDeg, thetaDeg, results[i]);
+      }
+    });
+}
+
+
+
+void GeolocationBatch::evaluateAll(Double_t phiDeg, Double_t thetaDeg, std::vector<Result>& results) const {
+  std::vector<Int_t> candidateInds(fPool.size());
+  for(UInt_t i=0; i < candidateInds.size(); i++){
+    candidateInds[i] = i;
+  }
+  evaluate(candidateInds, phiDeg, thetaDeg, results);
+}
@@ -0,0 +1,62 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Works out where a reconstructed direction would point on the ground for many minimum bias
+             candidates at once, spread across threads, and whether that passes the blinding selection
+             (on the continent and facing away from ANITA's heading).
+             The continent check is RampdemReader::isOnContinent unless a ContinentRaster is given, which is
+             quicker but can disagree with it right at the coast.
+*************************************************************************************************************** */
+
+#ifndef GEOLOCATIONBATCH_H
+#define GEOLOCATIONBATCH_H
+
+#include "Rtypes.h"
+
+#include <vector>
+
+class MinBiasCandidatePool;
+class ContinentRaster;
+
+class GeolocationBatch {
+
+public:
+
+  struct Result {
+    Int_t retVal; // from UsefulAdu5Pat::getSourceLonAndLatAtAlt, 1 if the direction hits the ground
+    Double_t sourceLon;
+    Double_t sourceLat;
+    Double_t sourceAltitude;
+    Double_t eventBearing; // degrees between heading and the peak phi
+    Bool_t onContinent;
+    Bool_t southFacing;
+    Bool_t accepted() const {return onContinent && southFacing;}
+  };
+
+  // raster can be NULL, for the exact continent check
+  GeolocationBatch(const MinBiasCandidatePool& pool, const ContinentRaster* raster, Int_t numWorkers = 1);
+
+  // Results for the peak (phiDeg, thetaDeg) seen from each candidate, candidateInds of -1 are not accepted
+  void evaluate(const std::vector<Int_t>& candidateInds, Double_t phiDeg, Double_t thetaDeg, std::vector<Result>& results) const;
+
+  // Same for every candidate in the pool
+  void evaluateAll(Double_t phiDeg, Double_t thetaDeg, std::vector<Result>& results) const;
+
+  // RampdemReader and AnitaGeomTool load their data the first time they're asked anything, which isn't
+  // thread safe. Called by the constructor, call it on the main thread before any other threaded
+  // geolocation (e.g. UsefulAdu5Pat or SurfaceAboveGeoid in a WorkPool task).
+  static void warmUp();
+
+private:
+
+  void evaluateOne(Int_t candidateInd, Double_t phiDeg, Double_t thetaDeg, Result& result) const;
+
+  const MinBiasCandidatePool& fPool;
+  const ContinentRaster* fRaster;
+  Int_t fNumWorkers;
+};
+
+#endif
@@ -0,0 +1,106 @@
+#include "HilbertEnvelope.h"
+#include "FFTWPlanner.h"
+
+#include "TMath.h"
+
+#include <fftw3.h>
+
+#include <cstring>
+
+struct HilbertEnvelope::LengthCache {
+  Int_t numPoints;
+  Int_t numFreqs;
+  Double_t* timeBuffer;
+  fftw_complex* freqBuffer;
+  fftw_plan forward;
+  fftw_plan backward;
+};
+
+
+
+HilbertEnvelope::HilbertEnvelope(){
+
+}
+
+
+
+HilbertEnvelope::~HilbertEnvelope(){
+
+  for(std::map<Int_t, LengthCache*>::iterator it = fCaches.begin(); it != fCaches.end(); ++it){
+    LengthCache* cache = it->second;
+    FFTWPlanner::destroy(cache->forward);
+    FFTWPlanner::destroy(cache->backward);
+    fftw_free(cache->timeBuffer);
+    fftw_free(cache->freqBuffer);
+    delete cache;
+  }
+}
+
+
+
+HilbertEnvelope::LengthCache* HilbertEnvelope::getCache(Int_t numPoints){
+
+  std::map<Int_t, LengthCache*>::iterator it = fCaches.find(numPoints);
+  if(it != fCaches.end()){
+    return it->second;
+  }
+
+  LengthCache* cache = new LengthCache();
+  cache->numPoints = numPoints;
+  cache->numFreqs = numPoints/2 + 1;
+  cache->timeBuffer = fftw_alloc_real(numPoints);
+  cache->freqBuffer = fftw_alloc_complex(cache->numFreqs);
+  cache->forward = FFTWPlanner::makeForward(numPoints, cache->timeBuffer, cache->freqBuffer);
+  cache->backward = FFTWPlanner::makeBackward(numPoints, cache->freqBuffer, cache->timeBuffer);
+  fCaches[numPoints] = cache;
+  return cache;
+}
+
+
+
+HilbertEnvelope::LengthCache* HilbertEnvelope::transform(const Double_t* y, Int_t numPoints){
+
+  LengthCache* cache = getCache(numPoints);
+
+  memcpy(cache->timeBuffer, y, numPoints*sizeof(Double_t));
+  fftw_execute(cache->forward);
+
+  // Multiply by -i (and 1/N for the round trip), the DC and Nyquist bins come out as zero either way
+  const Double_t norm = 1./numPoints;
+  fftw_complex* freqs = cache->freqBuffer;
+  for(Int_t freqInd=0; freqInd < cache->numFreqs; freqInd++){
+    const Double_t re = freqs[freqInd][0];
+    freqs[freqInd][0] = freqs[freqInd][1]*norm;
+    freqs[freqInd][1] = -re*norm;
+  }
+  fftw_execute(cache->backward);
+  return cache;
+}
+
+
+
+void HilbertEnvelope::getEnvelope(const Double_t* y, Int_t numPoints, Double_t* envelope){
+
+  if(numPoints <= 0){
+    return;
+  }
+  const Double_t* hilbert = transform(y, numPoints)->timeBuffer;
+  for(Int_t samp=0; samp < numPoints; samp++){
+    envelope[samp] = TMath::Sqrt(y[samp]*y[samp] + hilbert[samp]*hilbert[samp]);
+  }
+}
+
+
+
+Double_t HilbertEnvelope::getPeak(const Double_t* y, Int_t numPoints){
+
+  if(numPoints <= 0){
+    return 0;
+  }
+  const Double_t* hilbert = transform(y, numPoints)->timeBuffer;
+  Double_t maxEnvelope2 = 0;
+  for(Int_t samp=0; samp < numPoints; samp++){
+    maxEnvelope2 = TMath::Max(maxEnvelope2, y[samp]*y[samp] + hilbert[samp]*hilbert[samp]);
+  }
+  return TMath::Sqrt(maxEnvelope2);
+}
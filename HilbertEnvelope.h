@@ -0,0 +1,46 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             sqrt(y^2 + hilbert(y)^2) without making TGraphs, the same envelope as FFTtools::getHilbertEnvelope.
+             Keeps an FFTW plan pair and aligned buffers for each waveform length, so nothing is allocated
+             once it has seen a length. Not thread safe, use one per thread.
+*************************************************************************************************************** */
+
+#ifndef HILBERTENVELOPE_H
+#define HILBERTENVELOPE_H
+
+#include "Rtypes.h"
+
+#include <map>
+
+class HilbertEnvelope {
+
+public:
+
+  HilbertEnvelope();
+  ~HilbertEnvelope();
+
+  // Fills envelope (numPoints long) from y
+  void getEnvelope(const Double_t* y, Int_t numPoints, Double_t* envelope);
+
+  // Just the biggest value of the envelope, what RootTools::getMaxMin would find
+  Double_t getPeak(const Double_t* y, Int_t numPoints);
+
+private:
+
+  HilbertEnvelope(const HilbertEnvelope&);
+  HilbertEnvelope& operator=(const HilbertEnvelope&);
+
+  struct LengthCache;
+  LengthCache* getCache(Int_t numPoints);
+
+  // leaves hilbert(y) in the cache's time buffer
+  LengthCache* transform(const Double_t* y, Int_t numPoints);
+
+  std::map<Int_t, LengthCache*> fCaches;
+};
+
+#endif
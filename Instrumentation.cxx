@@ -0,0 +1,104 @@
+#include "Instrumentation.h"
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <string>
+#include <mutex>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+namespace {
+
+  std::mutex& registryMutex(){
+    static std::mutex m;
+    return m;
+  }
+
+  std::vector<Instrumentation::StageData*>& registry(){
+    static std::vector<Instrumentation::StageData*>* stages = new std::vector<Instrumentation::StageData*>();
+    return *stages;
+  }
+
+  void dumpAtExit(){
+    Instrumentation::dump();
+  }
+
+  Bool_t initEnabled(){
+    if(getenv("BLINDING_INSTRUMENTATION")==NULL){
+      return false;
+    }
+    atexit(dumpAtExit);
+    return true;
+  }
+}
+
+Bool_t Instrumentation::detail::enabled = initEnabled();
+
+
+Instrumentation::StageData* Instrumentation::detail::registerStage(const char* name, Bool_t isTimer){
+  std::lock_guard<std::mutex> lock(registryMutex());
+  StageData* data = new StageData();
+  data->name = name;
+  data->isTimer = isTimer;
+  data->calls = 0;
+  data->totalNs = 0;
+  registry().push_back(data);
+  return data;
+}
+
+
+void Instrumentation::dump(){
+
+  const char* outName = getenv("BLINDING_INSTRUMENTATION");
+  if(!detail::enabled || outName==NULL){
+    return;
+  }
+
+  // The name is never used as a format string, the pid goes in by hand
+  std::string fileName;
+  if(strcmp(outName, "1")==0 || strlen(outName)==0){
+    fileName = "instrumentation_" + std::to_string(getpid()) + ".json";
+  }
+  else{
+    fileName = outName;
+    const size_t token = fileName.find("%p");
+    if(token!=std::string::npos){
+      fileName.replace(token, 2, std::to_string(getpid()));
+    }
+    else{
+      fileName += "." + std::to_string(getpid());
+    }
+  }
+
+  std::ofstream out(fileName.c_str());
+  if(!out.is_open()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open " << fileName << std::endl;
+    return;
+  }
+
+  std::lock_guard<std::mutex> lock(registryMutex());
+  const std::vector<StageData*>& stages = registry();
+
+  out << "{" << std::endl;
+  out << "  \"pid\": " << getpid() << "," << std::endl;
+  out << "  \"timers\": {";
+  Bool_t first = true;
+  for(UInt_t i=0; i < stages.size(); i++){
+    if(!stages.at(i)->isTimer) continue;
+    out << (first ? "" : ",") << std::endl << "    \"" << stages.at(i)->name << "\": {\"calls\": " << stages.at(i)->calls
+	<< ", \"seconds\": " << 1e-9*stages.at(i)->totalNs << "}";
+    first = false;
+  }
+  out << std::endl << "  }," << std::endl;
+  out << "  \"counters\": {";
+  first = true;
+  for(UInt_t i=0; i < stages.size(); i++){
+    if(stages.at(i)->isTimer) continue;
+    out << (first ? "" : ",") << std::endl << "    \"" << stages.at(i)->name << "\": " << stages.at(i)->calls;
+    first = false;
+  }
+  out << std::endl << "  }" << std::endl;
+  out << "}" << std::endl;
+}
@@ -0,0 +1,91 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Lightweight stage timers and counters, for seeing where production jobs spend their time.
+             Switched off unless the environment variable BLINDING_INSTRUMENTATION is set, in which case
+             a JSON summary is written at exit to the file it names (the first "%p" is replaced by the
+             process id, or ".<pid>" is appended if there isn't one, and "1" means instrumentation_<pid>.json).
+             When off, a timer or counter costs one branch.
+
+             Instrumentation::Timer readTimer("TChain read"); // file scope, registered once
+             ...
+             {
+               Instrumentation::ScopedTimer t(readTimer);
+               headChain->GetEntry(entry);
+             }
+*************************************************************************************************************** */
+
+#ifndef INSTRUMENTATION_H
+#define INSTRUMENTATION_H
+
+#include "Rtypes.h"
+
+#include <atomic>
+#include <chrono>
+
+namespace Instrumentation {
+
+  struct StageData {
+    const char* name;
+    Bool_t isTimer;
+    std::atomic<Long64_t> calls;
+    std::atomic<Long64_t> totalNs;
+  };
+
+  namespace detail {
+    extern Bool_t enabled;
+    StageData* registerStage(const char* name, Bool_t isTimer);
+  }
+
+  inline Bool_t isEnabled(){
+    return detail::enabled;
+  }
+
+  // Writes the JSON summary now, also happens automatically at exit
+  void dump();
+
+  class Timer {
+  public:
+    Timer(const char* name) : fData(detail::registerStage(name, true)) {}
+    inline void add(Long64_t ns){
+      fData->calls++;
+      fData->totalNs += ns;
+    }
+  private:
+    StageData* fData; // never deleted, so timers at file scope can't be destroyed before the exit dump
+  };
+
+  class Counter {
+  public:
+    Counter(const char* name) : fData(detail::registerStage(name, false)) {}
+    inline void add(Long64_t n = 1){
+      if(detail::enabled){
+	fData->calls += n;
+      }
+    }
+  private:
+    StageData* fData;
+  };
+
+  class ScopedTimer {
+  public:
+    inline ScopedTimer(Timer& timer) : fTimer(timer) {
+      if(detail::enabled){
+	fStart = std::chrono::steady_clock::now();
+      }
+    }
+    inline ~ScopedTimer(){
+      if(detail::enabled){
+	fTimer.add(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - fStart).count());
+      }
+    }
+  private:
+    Timer& fTimer;
+    std::chrono::steady_clock::time_point fStart;
+  };
+}
+
+#endif
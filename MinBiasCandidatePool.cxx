@@ -0,0 +1,107 @@
+#include "MinBiasCandidatePool.h"
+#include "EventNumberSet.h"
+#include "RealTimeIndex.h"
+
+#include "TChain.h"
+
+#include "RawAnitaHeader.h"
+#include "Adu5Pat.h"
+#include "ProgressBar.h"
+
+#include <iostream>
+
+MinBiasCandidatePool::MinBiasCandidatePool(){
+  fFirstRealTime = 0;
+}
+
+
+
+Int_t MinBiasCandidatePool::fill(TChain* headChain, TChain* gpsChain, const RealTimeIndex& realTimeIndex,
+				 const EventNumberSet& decimated, UInt_t firstRealTime, UInt_t lastRealTime){
+
+  if(lastRealTime < firstRealTime){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", lastRealTime " << lastRealTime
+	      << " is before firstRealTime " << firstRealTime << std::endl;
+    return 1;
+  }
+  if(realTimeIndex.getEntries()!=headChain->GetEntries()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", the realTime index has " << realTimeIndex.getEntries()
+	      << " entries but the header chain has " << headChain->GetEntries() << std::endl;
+    return 1;
+  }
+
+  fFirstRealTime = firstRealTime;
+  fSecondToCandidate.assign(lastRealTime - firstRealTime + 1, -1);
+  fRealTime.clear();
+  fEventNumber.clear();
+  fHeading.clear();
+  fPitch.clear();
+  fRoll.clear();
+  fLatitude.clear();
+  fLongitude.clear();
+  fAltitude.clear();
+
+  //*************************************************************************
+  // Read the one header per second the sampler could land on, in entry order,
+  // only unpacking what's needed for selection
+  //*************************************************************************
+
+  RawAnitaHeader* header = NULL;
+  Adu5Pat* pat = NULL;
+  headChain->SetBranchAddress("header", &header);
+  gpsChain->SetBranchAddress("pat", &pat);
+  if(headChain->GetBranch("eventNumber")){
+    headChain->SetBranchStatus("*", 0);
+    headChain->SetBranchStatus("realTime", 1);
+    headChain->SetBranchStatus("eventNumber", 1);
+    headChain->SetBranchStatus("trigType", 1);
+  }
+
+  const UInt_t numSeconds = fSecondToCandidate.size();
+  std::cout << "Finding minimum bias candidates in " << numSeconds << " seconds" << std::endl;
+  ProgressBar p(numSeconds);
+  for(UInt_t second=0; second < numSeconds; second++){
+    const Long64_t entry = realTimeIndex.getEntryNumberWithIndex(firstRealTime + second);
+    if(entry >= 0){
+      headChain->GetEntry(entry);
+
+      if(header->getTriggerBitSoftExt() > 0 && !decimated.contains(header->eventNumber)){
+
+	gpsChain->GetEntry(entry);
+
+	fSecondToCandidate[second] = fEventNumber.size();
+	fRealTime.push_back(header->realTime);
+	fEventNumber.push_back(header->eventNumber);
+	fHeading.push_back(pat->heading);
+	fPitch.push_back(pat->pitch);
+	fRoll.push_back(pat->roll);
+	fLatitude.push_back(pat->latitude);
+	fLongitude.push_back(pat->longitude);
+	fAltitude.push_back(pat->altitude);
+      }
+    }
+    p.inc(second, numSeconds);
+  }
+
+  headChain->SetBranchStatus("*", 1);
+  headChain->ResetBranchAddresses();
+  gpsChain->ResetBranchAddresses();
+  delete header;
+  delete pat;
+
+  std::cout << "Found " << fEventNumber.size() << " minimum bias candidates" << std::endl;
+
+  return 0;
+}
+
+
+
+void MinBiasCandidatePool::getPat(Int_t candidateInd, Adu5Pat* pat) const {
+  pat->realTime = fRealTime.at(candidateInd);
+  pat->heading = fHeading.at(candidateInd);
+  pat->pitch = fPitch.at(candidateInd);
+  pat->roll = fRoll.at(candidateInd);
+  pat->latitude = fLatitude.at(candidateInd);
+  pat->longitude = fLongitude.at(candidateInd);
+  pat->altitude = fAltitude.at(candidateInd);
+}
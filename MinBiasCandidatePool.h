@@ -0,0 +1,68 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             The minimum bias events that makeAnita3OverwrittenEventList is allowed to overwrite, read from the
+             header and gps chains in one pass in entry order and kept in memory as columns.
+
+             The sampler draws a random second and asks the realTime index of the header chain for an entry.
+             Here each second of the flight maps straight to its candidate: the entry that index lookup would
+             return (the header TTreeIndex picks for that realTime, see RealTimeIndex for which one that is),
+             if it's soft/ext triggered and not in the decimated data set. Seconds that would be rejected map to -1.
+*************************************************************************************************************** */
+
+#ifndef MINBIASCANDIDATEPOOL_H
+#define MINBIASCANDIDATEPOOL_H
+
+#include "Rtypes.h"
+
+#include <vector>
+
+class TChain;
+class Adu5Pat;
+class EventNumberSet;
+class RealTimeIndex;
+
+class MinBiasCandidatePool {
+
+public:
+
+  MinBiasCandidatePool();
+
+  // Covers seconds firstRealTime to lastRealTime (inclusive), only reading the entry the index gives for each.
+  // The gps chain is read with the same entry as the header chain, like the sampler does.
+  Int_t fill(TChain* headChain, TChain* gpsChain, const RealTimeIndex& realTimeIndex,
+	     const EventNumberSet& decimated, UInt_t firstRealTime, UInt_t lastRealTime);
+
+  // Index of the candidate for this second, or -1 if there isn't an acceptable one
+  inline Int_t find(UInt_t realTime) const {
+    if(realTime < fFirstRealTime || realTime - fFirstRealTime >= fSecondToCandidate.size()){
+      return -1;
+    }
+    return fSecondToCandidate[realTime - fFirstRealTime];
+  }
+
+  size_t size() const {return fEventNumber.size();}
+  UInt_t getRealTime(Int_t candidateInd) const {return fRealTime.at(candidateInd);}
+  UInt_t getEventNumber(Int_t candidateInd) const {return fEventNumber.at(candidateInd);}
+  void getPat(Int_t candidateInd, Adu5Pat* pat) const;
+
+private:
+
+  UInt_t fFirstRealTime;
+  std::vector<Int_t> fSecondToCandidate;
+
+  // one entry per candidate
+  std::vector<UInt_t> fRealTime;
+  std::vector<UInt_t> fEventNumber;
+  std::vector<Float_t> fHeading;
+  std::vector<Float_t> fPitch;
+  std::vector<Float_t> fRoll;
+  std::vector<Float_t> fLatitude;
+  std::vector<Float_t> fLongitude;
+  std::vector<Float_t> fAltitude;
+};
+
+#endif
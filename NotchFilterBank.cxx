@@ -0,0 +1,189 @@
+#include "NotchFilterBank.h"
+#include "FrequencyDomainFilter.h"
+#include "CoherentSumKernel.h"
+#include "ContentHash.h"
+
+#include "CrossCorrelator.h"
+
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <map>
+#include <mutex>
+
+namespace {
+  std::mutex bankCacheMutex;
+  std::map<std::string, NotchFilterBank*> bankCache;
+}
+
+
+
+NotchFilterBank::NotchFilterBank(){
+
+}
+
+
+
+void NotchFilterBank::add(const char* name, const char* title, Double_t minFreqMHz, Double_t maxFreqMHz){
+  fNames.push_back(name);
+  fTitles.push_back(title);
+  fMinFreqs.push_back(minFreqMHz);
+  fMaxFreqs.push_back(maxFreqMHz);
+}
+
+
+
+Int_t NotchFilterBank::readFile(const char* fileName){
+
+  std::ifstream inFile(fileName);
+  if(!inFile.is_open()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open " << fileName << std::endl;
+    return 1;
+  }
+
+  std::string line;
+  Int_t lineNumber = 0;
+  while(std::getline(inFile, line)){
+    lineNumber++;
+    const size_t firstChar = line.find_first_not_of(" \t\r");
+    if(firstChar==std::string::npos || line[firstChar]=='#'){
+      continue;
+    }
+
+    std::istringstream lineStream(line);
+    std::string name;
+    Double_t minFreqMHz, maxFreqMHz;
+    if(!(lineStream >> name >> minFreqMHz >> maxFreqMHz) || minFreqMHz >= maxFreqMHz){
+      std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", can't make a notch from line " << lineNumber
+		<< " of " << fileName << ": " << line << std::endl;
+      return 1;
+    }
+
+    // the rest of the line is the title
+    std::string title;
+    std::getline(lineStream, title);
+    const size_t titleStart = title.find_first_not_of(" \t");
+    const size_t titleEnd = title.find_last_not_of(" \t\r");
+    title = titleStart==std::string::npos ? name : title.substr(titleStart, titleEnd - titleStart + 1);
+
+    add(name.c_str(), title.c_str(), minFreqMHz, maxFreqMHz);
+  }
+
+  return 0;
+}
+
+
+
+Int_t NotchFilterBank::writeFile(const char* fileName) const {
+
+  std::ofstream outFile(fileName);
+  if(!outFile.is_open()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open " << fileName << std::endl;
+    return 1;
+  }
+
+  outFile << "# name minFreqMHz maxFreqMHz title" << std::endl;
+  for(UInt_t i=0; i < size(); i++){
+    outFile << fNames.at(i).Data() << " " << fMinFreqs.at(i) << " " << fMaxFreqs.at(i)
+	    << " " << fTitles.at(i).Data() << std::endl;
+  }
+
+  if(!outFile.good()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", failed writing " << fileName << std::endl;
+    return 1;
+  }
+  return 0;
+}
+
+
+
+const NotchFilterBank* NotchFilterBank::fromFile(const char* fileName){
+
+  std::lock_guard<std::mutex> lock(bankCacheMutex);
+  std::map<std::string, NotchFilterBank*>::iterator it = bankCache.find(fileName);
+  if(it != bankCache.end()){
+    return it->second;
+  }
+
+  NotchFilterBank* bank = new NotchFilterBank();
+  if(bank->readFile(fileName)!=0){
+    delete bank;
+    return NULL;
+  }
+  bankCache[fileName] = bank;
+  return bank;
+}
+
+
+
+const NotchFilterBank& NotchFilterBank::anita3(){
+
+  static NotchFilterBank bank;
+  static std::once_flag made;
+  std::call_once(made, [](){
+      bank.add("n260Notch", "260MHz Satellite And 200MHz Notch Notch", 260-26, 260+26);
+      bank.add("n370Notch", "370MHz Satellite Notch", 370-26, 370+26);
+      bank.add("n400Notch", "400 MHz Satellite Notch", 400-10, 410);
+      bank.add("n762Notch", "762MHz Satellite Notch (one bin wide)", 762-8, 762+8);
+      bank.add("n200Notch", "200 MHz high pass band", 0, 200);
+      bank.add("n1200Notch", "1200 MHz low pass band", 1200, 9999);
+    });
+  return bank;
+}
+
+
+
+Bool_t NotchFilterBank::passes(Double_t freqMHz) const {
+  for(UInt_t i=0; i < size(); i++){
+    if(freqMHz >= fMinFreqs[i] && freqMHz < fMaxFreqs[i]){
+      return false;
+    }
+  }
+  return true;
+}
+
+
+
+void NotchFilterBank::addTo(CrossCorrelator* cc) const {
+  for(UInt_t i=0; i < size(); i++){
+    CrossCorrelator::SimpleNotch notch(fNames.at(i).Data(), fTitles.at(i).Data(), fMinFreqs.at(i), fMaxFreqs.at(i));
+    cc->addNotch(notch);
+  }
+}
+
+
+
+void NotchFilterBank::addTo(FrequencyDomainFilter* filter) const {
+  for(UInt_t i=0; i < size(); i++){
+    filter->addStopBand(fMinFreqs.at(i), fMaxFreqs.at(i));
+  }
+}
+
+
+
+void NotchFilterBank::addTo(CoherentSumKernel* kernel) const {
+  for(UInt_t i=0; i < size(); i++){
+    kernel->addStopBand(fMinFreqs.at(i), fMaxFreqs.at(i));
+  }
+}
+
+
+
+void NotchFilterBank::addTo(ContentHash& hash) const {
+  hash.add(size());
+  for(UInt_t i=0; i < size(); i++){
+    hash.add(fMinFreqs.at(i));
+    hash.add(fMaxFreqs.at(i));
+  }
+}
+
+
+
+TString NotchFilterBank::toString() const {
+  TString description;
+  for(UInt_t i=0; i < size(); i++){
+    description += TString::Format("%s %g %g\n", fNames.at(i).Data(), fMinFreqs.at(i), fMaxFreqs.at(i));
+  }
+  return description;
+}
@@ -0,0 +1,79 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             A named set of notches (stop bands in MHz), so the same bands can go into a CrossCorrelator,
+             a FrequencyDomainFilter and a CoherentSumKernel, and can be read from a text file instead
+             of being written out in each program. Files look like
+
+             # name minFreqMHz maxFreqMHz title
+             n260Notch 234 286 260MHz Satellite And 200MHz Notch Notch
+
+             anita3() is the only copy of the usual six, anita3().writeFile() gives a file to start from.
+             The filters compile the bands into one mask per waveform length themselves. CrossCorrelator
+             notches after interpolating to an even grid, so it's given the bank as SimpleNotches; filtering
+             the unevenly sampled waveforms beforehand instead isn't the same thing.
+*************************************************************************************************************** */
+
+#ifndef NOTCHFILTERBANK_H
+#define NOTCHFILTERBANK_H
+
+#include "Rtypes.h"
+#include "TString.h"
+
+#include <vector>
+
+class CrossCorrelator;
+class FrequencyDomainFilter;
+class CoherentSumKernel;
+class ContentHash;
+
+class NotchFilterBank {
+
+public:
+
+  NotchFilterBank();
+
+  void add(const char* name, const char* title, Double_t minFreqMHz, Double_t maxFreqMHz);
+
+  // Appends the notches in fileName, returns 0 on success
+  Int_t readFile(const char* fileName);
+  Int_t writeFile(const char* fileName) const;
+
+  // Kept for the life of the program, so the pointer can be shared, NULL if the file can't be read
+  static const NotchFilterBank* fromFile(const char* fileName);
+
+  // The six notches reconstruction has always used
+  static const NotchFilterBank& anita3();
+
+  UInt_t size() const {return fNames.size();}
+  const TString& getName(UInt_t i) const {return fNames.at(i);}
+  const TString& getTitle(UInt_t i) const {return fTitles.at(i);}
+  Double_t getMinFreqMHz(UInt_t i) const {return fMinFreqs.at(i);}
+  Double_t getMaxFreqMHz(UInt_t i) const {return fMaxFreqs.at(i);}
+
+  // Is freqMHz outside all the notches?
+  Bool_t passes(Double_t freqMHz) const;
+
+  // Adds every notch to the filter
+  void addTo(CrossCorrelator* cc) const;
+  void addTo(FrequencyDomainFilter* filter) const;
+  void addTo(CoherentSumKernel* kernel) const;
+
+  // The bands (not the names), for keying anything made with them
+  void addTo(ContentHash& hash) const;
+
+  // One "name minFreqMHz maxFreqMHz" line per notch, for recording which bank made an output file
+  TString toString() const;
+
+private:
+
+  std::vector<TString> fNames;
+  std::vector<TString> fTitles;
+  std::vector<Double_t> fMinFreqs;
+  std::vector<Double_t> fMaxFreqs;
+};
+
+#endif
@@ -0,0 +1,301 @@
+#include "RealTimeIndex.h"
+#include "ContentHash.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TChain.h"
+#include "TVirtualIndex.h"
+#include "TSystem.h"
+
+#include "RawAnitaHeader.h"
+
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <map>
+#include <cstring>
+
+namespace {
+
+  const char fileMagic[8] = {'R', 'T', 'I', 'N', 'D', 'E', 'X', '2'};
+
+  struct FileHeader {
+    char magic[8];
+    Int_t run;
+    UInt_t firstRealTime;
+    Long64_t numEntries;
+    ULong64_t headFileHash;
+    UInt_t numSeconds;
+    UInt_t numOutliers;
+  };
+
+  // realTimes further than this from the run's median are kept out of the per-second array
+  const UInt_t maxSecondsFromMedian = 86400;
+
+  ULong64_t hashFileName(const TString& fileName){
+    ContentHash h;
+    h.add(fileName.Data(), fileName.Length());
+    return h.digest();
+  }
+}
+
+
+
+RealTimeIndex::RealTimeIndex(){
+  fFirstRealTime = 0;
+  fNumEntries = 0;
+  fNumOverlapping = 0;
+}
+
+
+
+Int_t RealTimeIndex::addRun(Int_t run, const char* headFileName, const char* cacheFileName){
+
+  TFile* headFile = TFile::Open(headFileName);
+  TTree* headTree = headFile ? (TTree*) headFile->Get("headTree") : NULL;
+  if(headTree==NULL){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to find headTree in " << headFileName << std::endl;
+    delete headFile;
+    return 1;
+  }
+
+  TString headName = headFileName;
+  gSystem->ExpandPathName(headName);
+  TString cacheName = cacheFileName;
+  gSystem->ExpandPathName(cacheName);
+
+  RunIndex runIndex;
+  if(readRunIndex(cacheName, runIndex)!=0 || runIndex.run!=run || runIndex.numEntries!=headTree->GetEntries() ||
+     runIndex.headFileHash!=hashFileName(headName)){
+    runIndex.run = run;
+    runIndex.headFileHash = hashFileName(headName);
+    makeRunIndex(headTree, runIndex);
+    if(writeRunIndex(cacheName, runIndex)!=0){
+      std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", couldn't save the realTime index for run "
+		<< run << " to " << cacheName.Data() << ", it will be remade next time" << std::endl;
+    }
+  }
+
+  headFile->Close();
+  delete headFile;
+
+  const Long64_t numOverlappingBefore = fNumOverlapping;
+  merge(runIndex);
+  if(fNumOverlapping > numOverlappingBefore){
+    std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", " << fNumOverlapping - numOverlappingBefore
+	      << " seconds of run " << run << " are also in an earlier run, using run " << run
+	      << " for them (a chain realTime index could have picked either)" << std::endl;
+  }
+  return 0;
+}
+
+
+
+void RealTimeIndex::makeRunIndex(TTree* headTree, RunIndex& runIndex){
+
+  RawAnitaHeader* header = NULL;
+  headTree->SetBranchAddress("header", &header);
+  if(headTree->GetBranch("realTime")){
+    headTree->SetBranchStatus("*", 0);
+    headTree->SetBranchStatus("realTime", 1);
+  }
+
+  const Long64_t nEntries = headTree->GetEntries();
+  std::vector<UInt_t> realTimes(nEntries, 0);
+  for(Long64_t entry=0; entry < nEntries; entry++){
+    headTree->GetEntry(entry);
+    realTimes[entry] = header->realTime;
+  }
+  headTree->SetBranchStatus("*", 1);
+  headTree->ResetBranchAddresses();
+  delete header;
+
+  runIndex.numEntries = nEntries;
+  runIndex.firstRealTime = 0;
+  runIndex.secondToEntry.clear();
+  runIndex.outlierRealTimes.clear();
+  runIndex.outlierEntries.clear();
+  if(nEntries==0){
+    return;
+  }
+
+  // The TTreeIndex a TChainIndex would use for this run, its choice between headers in the same second
+  // is what the index has to reproduce (see the header)
+  headTree->BuildIndex("realTime");
+
+  std::vector<UInt_t> sorted = realTimes;
+  std::nth_element(sorted.begin(), sorted.begin() + nEntries/2, sorted.end());
+  const UInt_t median = sorted[nEntries/2];
+  const UInt_t lowest = median > maxSecondsFromMedian ? median - maxSecondsFromMedian : 0;
+  const UInt_t highest = median + maxSecondsFromMedian;
+
+  UInt_t minRealTime = median;
+  UInt_t maxRealTime = median;
+  for(Long64_t entry=0; entry < nEntries; entry++){
+    if(realTimes[entry] >= lowest && realTimes[entry] <= highest){
+      minRealTime = std::min(minRealTime, realTimes[entry]);
+      maxRealTime = std::max(maxRealTime, realTimes[entry]);
+    }
+  }
+
+  runIndex.firstRealTime = minRealTime;
+  runIndex.secondToEntry.assign(maxRealTime - minRealTime + 1, -1);
+  std::map<UInt_t, Int_t> outliers;
+  for(Long64_t entry=0; entry < nEntries; entry++){
+    const UInt_t realTime = realTimes[entry];
+    if(realTime >= minRealTime && realTime <= maxRealTime){
+      if(runIndex.secondToEntry[realTime - minRealTime] < 0){
+	runIndex.secondToEntry[realTime - minRealTime] = headTree->GetEntryNumberWithIndex(realTime);
+      }
+    }
+    else if(outliers.find(realTime)==outliers.end()){
+      outliers[realTime] = headTree->GetEntryNumberWithIndex(realTime);
+    }
+  }
+  for(std::map<UInt_t, Int_t>::const_iterator it = outliers.begin(); it!=outliers.end(); ++it){
+    runIndex.outlierRealTimes.push_back(it->first);
+    runIndex.outlierEntries.push_back(it->second);
+  }
+  if(outliers.size() > 0){
+    std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", run " << runIndex.run << " has " << outliers.size()
+	      << " realTimes more than a day from the rest, they're indexed separately" << std::endl;
+  }
+}
+
+
+
+Int_t RealTimeIndex::readRunIndex(const char* fileName, RunIndex& runIndex){
+
+  std::ifstream inFile(fileName, std::ifstream::in | std::ifstream::binary);
+  if(!inFile.is_open()){
+    return 1;
+  }
+  FileHeader fileHeader;
+  inFile.read((char*) &fileHeader, sizeof(fileHeader));
+  if(inFile.fail() || memcmp(fileHeader.magic, fileMagic, sizeof(fileMagic))!=0){
+    return 1;
+  }
+
+  runIndex.run = fileHeader.run;
+  runIndex.firstRealTime = fileHeader.firstRealTime;
+  runIndex.numEntries = fileHeader.numEntries;
+  runIndex.headFileHash = fileHeader.headFileHash;
+  runIndex.secondToEntry.resize(fileHeader.numSeconds);
+  if(fileHeader.numSeconds > 0){
+    inFile.read((char*) &runIndex.secondToEntry[0], sizeof(Int_t)*fileHeader.numSeconds);
+  }
+  runIndex.outlierRealTimes.resize(fileHeader.numOutliers);
+  runIndex.outlierEntries.resize(fileHeader.numOutliers);
+  if(fileHeader.numOutliers > 0){
+    inFile.read((char*) &runIndex.outlierRealTimes[0], sizeof(UInt_t)*fileHeader.numOutliers);
+    inFile.read((char*) &runIndex.outlierEntries[0], sizeof(Int_t)*fileHeader.numOutliers);
+  }
+  return inFile.fail() ? 1 : 0;
+}
+
+
+
+Int_t RealTimeIndex::writeRunIndex(const char* fileName, const RunIndex& runIndex){
+
+  std::ofstream outFile(fileName, std::ofstream::out | std::ofstream::binary);
+  if(!outFile.is_open()){
+    return 1;
+  }
+  FileHeader fileHeader;
+  memcpy(fileHeader.magic, fileMagic, sizeof(fileMagic));
+  fileHeader.run = runIndex.run;
+  fileHeader.firstRealTime = runIndex.firstRealTime;
+  fileHeader.numEntries = runIndex.numEntries;
+  fileHeader.headFileHash = runIndex.headFileHash;
+  fileHeader.numSeconds = runIndex.secondToEntry.size();
+  fileHeader.numOutliers = runIndex.outlierRealTimes.size();
+
+  outFile.write((const char*) &fileHeader, sizeof(fileHeader));
+  if(fileHeader.numSeconds > 0){
+    outFile.write((const char*) &runIndex.secondToEntry[0], sizeof(Int_t)*fileHeader.numSeconds);
+  }
+  if(fileHeader.numOutliers > 0){
+    outFile.write((const char*) &runIndex.outlierRealTimes[0], sizeof(UInt_t)*fileHeader.numOutliers);
+    outFile.write((const char*) &runIndex.outlierEntries[0], sizeof(Int_t)*fileHeader.numOutliers);
+  }
+  outFile.close();
+  return outFile.fail() ? 1 : 0;
+}
+
+
+
+void RealTimeIndex::merge(const RunIndex& runIndex){
+
+  const UInt_t numSeconds = runIndex.secondToEntry.size();
+  if(numSeconds > 0){
+    if(fSecondToEntry.size()==0){
+      fFirstRealTime = runIndex.firstRealTime;
+    }
+    else if(runIndex.firstRealTime < fFirstRealTime){
+      fSecondToEntry.insert(fSecondToEntry.begin(), fFirstRealTime - runIndex.firstRealTime, -1);
+      fFirstRealTime = runIndex.firstRealTime;
+    }
+    const UInt_t offset = runIndex.firstRealTime - fFirstRealTime;
+    if(offset + numSeconds > fSecondToEntry.size()){
+      fSecondToEntry.resize(offset + numSeconds, -1);
+    }
+    for(UInt_t second=0; second < numSeconds; second++){
+      if(runIndex.secondToEntry[second] >= 0){
+	if(fSecondToEntry[offset + second] >= 0){
+	  fNumOverlapping++;
+	}
+	fSecondToEntry[offset + second] = fNumEntries + runIndex.secondToEntry[second];
+      }
+    }
+  }
+
+  for(UInt_t i=0; i < runIndex.outlierRealTimes.size(); i++){
+    const std::pair<UInt_t, Long64_t> outlier(runIndex.outlierRealTimes[i], fNumEntries + runIndex.outlierEntries[i]);
+    std::vector<std::pair<UInt_t, Long64_t> >::iterator it = std::lower_bound(fOutliers.begin(), fOutliers.end(), outlier,
+									       [](const std::pair<UInt_t, Long64_t>& a, const std::pair<UInt_t, Long64_t>& b){return a.first < b.first;});
+    if(it!=fOutliers.end() && it->first==outlier.first){
+      it->second = outlier.second;
+      fNumOverlapping++;
+    }
+    else{
+      fOutliers.insert(it, outlier);
+    }
+  }
+
+  fNumEntries += runIndex.numEntries;
+}
+
+
+
+Long64_t RealTimeIndex::findOutlier(UInt_t realTime) const {
+  const std::pair<UInt_t, Long64_t> outlier(realTime, -1);
+  std::vector<std::pair<UInt_t, Long64_t> >::const_iterator it = std::lower_bound(fOutliers.begin(), fOutliers.end(), outlier,
+										   [](const std::pair<UInt_t, Long64_t>& a, const std::pair<UInt_t, Long64_t>& b){return a.first < b.first;});
+  return (it!=fOutliers.end() && it->first==realTime) ? it->second : -1;
+}
+
+
+
+Long64_t RealTimeIndex::compareWithTreeIndex(TChain* headChain, UInt_t firstRealTime, UInt_t lastRealTime) const {
+
+  headChain->BuildIndex("realTime");
+
+  Long64_t numDifferent = 0;
+  for(Long64_t realTime=firstRealTime; realTime <= lastRealTime; realTime++){
+    const Long64_t treeIndexEntry = headChain->GetEntryNumberWithIndex(realTime);
+    const Long64_t entry = getEntryNumberWithIndex(realTime);
+    if(entry!=treeIndexEntry){
+      if(numDifferent < 10){
+	std::cerr << "realTime " << realTime << ": TTreeIndex gives entry " << treeIndexEntry
+		  << ", RealTimeIndex gives " << entry << std::endl;
+      }
+      numDifferent++;
+    }
+  }
+
+  TVirtualIndex* treeIndex = headChain->GetTreeIndex();
+  headChain->SetTreeIndex(NULL);
+  delete treeIndex;
+
+  return numDifferent;
+}
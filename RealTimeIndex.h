@@ -0,0 +1,92 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             A replacement for headChain->BuildIndex("realTime") that doesn't need to read every header each time.
+             Each run gets a small file in DataDirectory::getCacheDirectory() (realTimeIndex<run>.dat, about 40 kB)
+             with one entry per second of the run, made the first time the run is used.
+             Lookups are a single array access, for the whole flight the index is ~20 MB rather than >1 GB.
+             The run files are read into memory and merged rather than memory mapped, they're small and the
+             merged array is what gets looked up.
+
+             Which header comes back for a second with several: TTreeIndex sorts with std::sort, which isn't
+             stable, and returns the first of the equal values in that order. So it's not the first or last
+             entry, just whichever one the sort left first. A TChain index (TChainIndex) asks each run's own
+             TTreeIndex, so each run file is made by building that TTreeIndex and asking it, which gives the
+             same header as the chain index with the same ROOT version. compareWithTreeIndex() checks that.
+
+             Headers with a realTime more than a day from the rest of their run don't go in the per-second
+             array (one junk timestamp would make it huge) but are kept beside it, so nothing is dropped.
+             Runs must be added in the same order as the head files are added to the chain. If a second
+             appears in more than one run the later run wins. TChainIndex can't be used for runs that
+             overlap, the old chain-wide TTreeIndex could pick either, so overlapping seconds are counted.
+*************************************************************************************************************** */
+
+#ifndef REALTIMEINDEX_H
+#define REALTIMEINDEX_H
+
+#include "Rtypes.h"
+
+#include <vector>
+#include <utility>
+
+class TTree;
+class TChain;
+
+class RealTimeIndex {
+
+public:
+
+  RealTimeIndex();
+
+  // cacheFileName is read if it matches the head file, otherwise it's (re)made from the head file
+  Int_t addRun(Int_t run, const char* headFileName, const char* cacheFileName);
+
+  // Entry in the chain of the header the realTime TTreeIndex gives for this realTime, or -1 if there isn't one
+  inline Long64_t getEntryNumberWithIndex(UInt_t realTime) const {
+    if(realTime >= fFirstRealTime && realTime - fFirstRealTime < fSecondToEntry.size() &&
+       fSecondToEntry[realTime - fFirstRealTime] >= 0){
+      return fSecondToEntry[realTime - fFirstRealTime];
+    }
+    return fOutliers.size() > 0 ? findOutlier(realTime) : -1;
+  }
+
+  // Builds headChain->BuildIndex("realTime") and counts the seconds from first to last where it disagrees.
+  // Needs the memory this class saves, so it's for checking a few runs at a time.
+  Long64_t compareWithTreeIndex(TChain* headChain, UInt_t firstRealTime, UInt_t lastRealTime) const;
+
+  UInt_t getFirstRealTime() const {return fFirstRealTime;}
+  UInt_t getLastRealTime() const {return fFirstRealTime + fSecondToEntry.size() - 1;}
+  Long64_t getEntries() const {return fNumEntries;}
+  Long64_t getNumOutliers() const {return fOutliers.size();}
+  Long64_t getNumOverlapping() const {return fNumOverlapping;}
+
+private:
+
+  struct RunIndex {
+    Int_t run;
+    Long64_t numEntries;
+    ULong64_t headFileHash; // of the expanded head file name, so a cache from another data directory isn't used
+    UInt_t firstRealTime;
+    std::vector<Int_t> secondToEntry; // entry within the run
+    std::vector<UInt_t> outlierRealTimes; // sorted
+    std::vector<Int_t> outlierEntries;
+  };
+
+  static Int_t readRunIndex(const char* fileName, RunIndex& runIndex);
+  static Int_t writeRunIndex(const char* fileName, const RunIndex& runIndex);
+  static void makeRunIndex(TTree* headTree, RunIndex& runIndex);
+
+  void merge(const RunIndex& runIndex);
+  Long64_t findOutlier(UInt_t realTime) const;
+
+  UInt_t fFirstRealTime;
+  Long64_t fNumEntries; // in all runs added so far, i.e. the chain entry of the next run's first header
+  Long64_t fNumOverlapping;
+  std::vector<Long64_t> fSecondToEntry;
+  std::vector<std::pair<UInt_t, Long64_t> > fOutliers; // realTime, chain entry, sorted by realTime
+};
+
+#endif
@@ -0,0 +1,365 @@
+#include "ReconstructionCache.h"
+#include "ContentHash.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TSystem.h"
+#include "TBranch.h"
+
+#include "AnitaEventSummary.h"
+#include "UsefulAnitaEvent.h"
+#include "RawAnitaHeader.h"
+#include "Adu5Pat.h"
+
+#include <iostream>
+#include <algorithm>
+
+#include <sys/file.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace {
+  // size and modification time, so a rebuilt file changes the key without reading it all
+  void addFileIdentity(ContentHash& hash, const char* fileName){
+    Long_t id = 0;
+    Long64_t size = -1;
+    Long_t flags = 0;
+    Long_t modTime = 0;
+    if(fileName!=NULL){
+      gSystem->GetPathInfo(fileName, &id, &size, &flags, &modTime);
+    }
+    hash.add(size);
+    hash.add(modTime);
+  }
+}
+
+bool ReconstructionCache::keyOrder(const Key& a, const Key& b){
+  return a.hi < b.hi || (a.hi==b.hi && a.lo < b.lo);
+}
+
+
+
+ReconstructionCache::ReconstructionCache(){
+  fOldFile = NULL;
+  fOldTree = NULL;
+  fOldSummary = NULL;
+  fNewFile = NULL;
+  fNewTree = NULL;
+  fNewKeyHi = 0;
+  fNewKeyLo = 0;
+  fNewSummary = NULL;
+  fNumHits = 0;
+  fNumMisses = 0;
+}
+
+
+
+ReconstructionCache::~ReconstructionCache(){
+  if(isOpen()){
+    close();
+  }
+}
+
+
+
+Int_t ReconstructionCache::open(const char* fileName){
+
+  fFileName = fileName;
+  // per process, so jobs sharing a cache don't write over each other's
+  fNewFileName = TString::Format("%s.%d.new", fFileName.Data(), gSystem->GetPid());
+  fKeys.clear();
+  fNewKeys.clear();
+  fNumHits = 0;
+  fNumMisses = 0;
+
+  //*************************************************************************
+  // Keys of the existing cache, if there is one
+  //*************************************************************************
+
+  if(!gSystem->AccessPathName(fileName)){
+    fOldFile = TFile::Open(fileName);
+    fOldTree = fOldFile ? (TTree*) fOldFile->Get("reconstructionCacheTree") : NULL;
+    if(fOldTree==NULL){
+      std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", unable to read " << fileName
+		<< ", starting a new cache" << std::endl;
+      delete fOldFile;
+      fOldFile = NULL;
+    }
+    else{
+      ULong64_t keyHi = 0;
+      ULong64_t keyLo = 0;
+      fOldTree->SetBranchAddress("keyHi", &keyHi);
+      fOldTree->SetBranchAddress("keyLo", &keyLo);
+      fOldTree->SetBranchStatus("*", 0);
+      fOldTree->SetBranchStatus("keyHi", 1);
+      fOldTree->SetBranchStatus("keyLo", 1);
+
+      const Long64_t nEntries = fOldTree->GetEntries();
+      fKeys.reserve(nEntries);
+      for(Long64_t entry=0; entry < nEntries; entry++){
+	fOldTree->GetEntry(entry);
+	Key key;
+	key.hi = keyHi;
+	key.lo = keyLo;
+	key.entry = entry;
+	fKeys.push_back(key);
+      }
+      std::sort(fKeys.begin(), fKeys.end(), keyOrder);
+
+      // from here on only summaries are read
+      fOldTree->SetBranchStatus("*", 1);
+      fOldTree->ResetBranchAddresses();
+      fOldTree->SetBranchStatus("keyHi", 0);
+      fOldTree->SetBranchStatus("keyLo", 0);
+      fOldTree->SetBranchAddress("eventSummary", &fOldSummary);
+
+      std::cout << "Read " << fKeys.size() << " keys from reconstruction cache " << fileName << std::endl;
+    }
+  }
+
+  //*************************************************************************
+  // The new cache
+  //*************************************************************************
+
+  fNewFile = new TFile(fNewFileName, "recreate");
+  if(fNewFile->IsZombie()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open " << fNewFileName << std::endl;
+    delete fNewFile;
+    fNewFile = NULL;
+    return 1;
+  }
+  fNewTree = new TTree("reconstructionCacheTree", "AnitaEventSummaries by ContentHash of their inputs");
+  fNewTree->Branch("keyHi", &fNewKeyHi);
+  fNewTree->Branch("keyLo", &fNewKeyLo);
+  fNewTree->Branch("eventSummary", &fNewSummary);
+
+  return 0;
+}
+
+
+
+Bool_t ReconstructionCache::find(ULong64_t keyHi, ULong64_t keyLo, AnitaEventSummary* eventSummary){
+
+  Key key;
+  key.hi = keyHi;
+  key.lo = keyLo;
+  key.entry = -1;
+  std::vector<Key>::const_iterator it = std::lower_bound(fKeys.begin(), fKeys.end(), key, keyOrder);
+  if(it==fKeys.end() || it->hi!=keyHi || it->lo!=keyLo){
+    fNumMisses++;
+    return false;
+  }
+
+  fOldTree->GetEntry(it->entry);
+  *eventSummary = *fOldSummary;
+  fNumHits++;
+  return true;
+}
+
+
+
+void ReconstructionCache::add(ULong64_t keyHi, ULong64_t keyLo, const AnitaEventSummary* eventSummary){
+
+  if(fNewTree==NULL){
+    return;
+  }
+  fNewKeyHi = keyHi;
+  fNewKeyLo = keyLo;
+  // only read by Fill
+  fNewSummary = const_cast<AnitaEventSummary*>(eventSummary);
+  fNewTree->Fill();
+
+  Key key;
+  key.hi = keyHi;
+  key.lo = keyLo;
+  key.entry = fNewTree->GetEntries() - 1;
+  fNewKeys.push_back(key);
+}
+
+
+
+Long64_t ReconstructionCache::mergeCurrent(){
+
+  // What's on disk now, which another job may have replaced since open()
+  if(gSystem->AccessPathName(fFileName)){
+    return 0;
+  }
+  TFile* currentFile = TFile::Open(fFileName);
+  TTree* currentTree = currentFile ? (TTree*) currentFile->Get("reconstructionCacheTree") : NULL;
+  if(currentTree==NULL){
+    std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", unable to read " << fFileName
+	      << ", nothing kept from it" << std::endl;
+    delete currentFile;
+    return 0;
+  }
+
+  ULong64_t keyHi = 0;
+  ULong64_t keyLo = 0;
+  AnitaEventSummary* summary = NULL;
+  currentTree->SetBranchAddress("keyHi", &keyHi);
+  currentTree->SetBranchAddress("keyLo", &keyLo);
+  currentTree->SetBranchAddress("eventSummary", &summary);
+  TBranch* keyHiBranch = currentTree->GetBranch("keyHi");
+  TBranch* keyLoBranch = currentTree->GetBranch("keyLo");
+
+  std::sort(fNewKeys.begin(), fNewKeys.end(), keyOrder);
+  std::vector<Key> copiedKeys;
+  const Long64_t nEntries = currentTree->GetEntries();
+  for(Long64_t entry=0; entry < nEntries; entry++){
+    keyHiBranch->GetEntry(entry);
+    keyLoBranch->GetEntry(entry);
+    Key key;
+    key.hi = keyHi;
+    key.lo = keyLo;
+    key.entry = entry;
+    // this job's summary wins
+    if(std::binary_search(fNewKeys.begin(), fNewKeys.end(), key, keyOrder)){
+      continue;
+    }
+    copiedKeys.push_back(key);
+  }
+
+  // copied in file order, once per key
+  std::stable_sort(copiedKeys.begin(), copiedKeys.end(), keyOrder);
+  copiedKeys.erase(std::unique(copiedKeys.begin(), copiedKeys.end(),
+			       [](const Key& a, const Key& b){return a.hi==b.hi && a.lo==b.lo;}),
+		   copiedKeys.end());
+  std::sort(copiedKeys.begin(), copiedKeys.end(), [](const Key& a, const Key& b){return a.entry < b.entry;});
+
+  for(UInt_t i=0; i < copiedKeys.size(); i++){
+    currentTree->GetEntry(copiedKeys[i].entry);
+    fNewKeyHi = copiedKeys[i].hi;
+    fNewKeyLo = copiedKeys[i].lo;
+    fNewSummary = summary;
+    fNewTree->Fill();
+  }
+
+  currentFile->Close();
+  delete currentFile;
+  delete summary;
+  return copiedKeys.size();
+}
+
+
+
+Int_t ReconstructionCache::close(){
+
+  if(fOldFile!=NULL){
+    fOldFile->Close();
+    delete fOldFile;
+    fOldFile = NULL;
+    fOldTree = NULL;
+  }
+  fKeys.clear();
+
+  if(fNewFile==NULL){
+    return 1;
+  }
+
+  // Held from reading what's on disk to replacing it, so a job finishing at the same time waits
+  // and then merges this one's entries in turn
+  const TString lockFileName = fFileName + ".lock";
+  const int lockFd = ::open(lockFileName.Data(), O_RDWR | O_CREAT, 0644);
+  if(lockFd < 0 || flock(lockFd, LOCK_EX)!=0){
+    std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", unable to lock " << lockFileName
+	      << ", a job finishing at the same time could lose this one's entries" << std::endl;
+  }
+
+  fNewFile->cd();
+  const Long64_t numKept = mergeCurrent();
+  fNewFile->Write();
+  fNewFile->Close();
+  delete fNewFile;
+  fNewFile = NULL;
+  fNewTree = NULL;
+  fNewSummary = NULL;
+  fNewKeys.clear();
+
+  std::cout << "Reconstruction cache: " << fNumHits << " hits, " << fNumMisses << " misses, "
+	    << numKept << " entries kept from other jobs" << std::endl;
+
+  Int_t status = 0;
+  if(gSystem->Rename(fNewFileName, fFileName)!=0){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to move " << fNewFileName
+	      << " to " << fFileName << std::endl;
+    status = 1;
+  }
+  if(lockFd >= 0){
+    flock(lockFd, LOCK_UN);
+    ::close(lockFd);
+  }
+  return status;
+}
+
+
+
+void ReconstructionCache::addCode(ContentHash& hash){
+
+  // The libraries the reconstruction runs in and the program itself, rebuilding any of them changes every key
+  const char* libNames[] = {"libAnitaAnalysisTools", "libAnitaEvent", "libRootFftwWrapper", "libBlindingTools"};
+  for(UInt_t i=0; i < sizeof(libNames)/sizeof(libNames[0]); i++){
+    char* path = gSystem->DynamicPathName(libNames[i], kTRUE);
+    addFileIdentity(hash, path);
+    delete [] path;
+  }
+  addFileIdentity(hash, "/proc/self/exe");
+}
+
+
+
+void ReconstructionCache::addEvent(ContentHash& hash, const UsefulAnitaEvent* usefulEvent){
+
+  hash.add(usefulEvent->eventNumber);
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    const Int_t numPoints = usefulEvent->fNumPoints[chanIndex];
+    hash.add(numPoints);
+    if(numPoints > 0){
+      hash.add(usefulEvent->fTimes[chanIndex], numPoints*sizeof(Double_t));
+      hash.add(usefulEvent->fVolts[chanIndex], numPoints*sizeof(Double_t));
+    }
+  }
+}
+
+
+
+void ReconstructionCache::addHeader(ContentHash& hash, const RawAnitaHeader* header){
+
+  // What AnitaEventSummary and the pulser flags read, plus the trigger info blinding overwrites
+  hash.add(header->run);
+  hash.add(header->eventNumber);
+  hash.add(header->realTime);
+  hash.add(header->payloadTime);
+  hash.add(header->payloadTimeUs);
+  hash.add(header->triggerTimeNs);
+  hash.add(header->trigTime);
+  hash.add(header->trigType);
+  hash.add(header->priority);
+  hash.add(header->l1TrigMask);
+  hash.add(header->l1TrigMaskH);
+  hash.add(header->phiTrigMask);
+  hash.add(header->phiTrigMaskH);
+  hash.add(header->l3TrigPattern);
+  hash.add(header->l3TrigPatternH);
+}
+
+
+
+void ReconstructionCache::addPat(ContentHash& hash, const Adu5Pat* pat){
+
+  hash.add(pat->run);
+  hash.add(pat->realTime);
+  hash.add(pat->readTime);
+  hash.add(pat->payloadTime);
+  hash.add(pat->payloadTimeUs);
+  hash.add(pat->timeOfDay);
+  hash.add(pat->latitude);
+  hash.add(pat->longitude);
+  hash.add(pat->altitude);
+  hash.add(pat->heading);
+  hash.add(pat->pitch);
+  hash.add(pat->roll);
+  hash.add(pat->mrms);
+  hash.add(pat->brms);
+  hash.add(pat->attFlag);
+  hash.add(pat->intFlag);
+}
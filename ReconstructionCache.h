@@ -0,0 +1,103 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             AnitaEventSummaries saved on disk under a ContentHash of everything that went into them:
+             the calibrated waveforms, the header, the pat and the reconstruction settings. If an event's
+             key is already in the cache its summary is copied out instead of reconstructed, so after a
+             new blinding version only the events that changed are reconstructed again.
+
+             open() reads the keys of the existing cache (it's fine if there isn't one) and starts a new
+             one beside it (fileName.<pid>.new, so jobs sharing a cache don't clash). close() takes a lock
+             (fileName.lock), copies in every entry of the cache as it is on disk then (another job may have
+             replaced it since open()) whose key wasn't add()ed, and moves the new file into place.
+             So the cache keeps every job's events and only grows.
+             The keys should start from everything that can change a summary: the settings, the notches, the
+             kernel flags and addCode() for the code itself.
+             Not thread safe, use it from the thread reading the events.
+*************************************************************************************************************** */
+
+#ifndef RECONSTRUCTIONCACHE_H
+#define RECONSTRUCTIONCACHE_H
+
+#include "Rtypes.h"
+#include "TString.h"
+
+#include <vector>
+
+class TFile;
+class TTree;
+class AnitaEventSummary;
+class UsefulAnitaEvent;
+class RawAnitaHeader;
+class Adu5Pat;
+class ContentHash;
+
+class ReconstructionCache {
+
+public:
+
+  ReconstructionCache();
+  ~ReconstructionCache();
+
+  // Returns 0 on success
+  Int_t open(const char* fileName);
+  Int_t close();
+  Bool_t isOpen() const {return fNewFile!=NULL;}
+
+  // Copies the cached summary into eventSummary, false if there isn't one
+  Bool_t find(ULong64_t keyHi, ULong64_t keyLo, AnitaEventSummary* eventSummary);
+
+  // Goes into the new cache, hit or not
+  void add(ULong64_t keyHi, ULong64_t keyLo, const AnitaEventSummary* eventSummary);
+
+  // The inputs of a key, field by field so it doesn't depend on the memory layout of the classes
+  static void addEvent(ContentHash& hash, const UsefulAnitaEvent* usefulEvent);
+  static void addHeader(ContentHash& hash, const RawAnitaHeader* header);
+  static void addPat(ContentHash& hash, const Adu5Pat* pat);
+
+  // Size and modification time of the ANITA libraries, libBlindingTools and the running program
+  static void addCode(ContentHash& hash);
+
+  Long64_t getNumHits() const {return fNumHits;}
+  Long64_t getNumMisses() const {return fNumMisses;}
+
+private:
+
+  ReconstructionCache(const ReconstructionCache&);
+  ReconstructionCache& operator=(const ReconstructionCache&);
+
+  struct Key {
+    ULong64_t hi;
+    ULong64_t lo;
+    Long64_t entry;
+  };
+  static bool keyOrder(const Key& a, const Key& b);
+
+  // Copies the entries of the cache on disk that this job didn't add into the new tree, returns how many
+  Long64_t mergeCurrent();
+
+  TString fFileName;
+  TString fNewFileName;
+
+  // the existing cache, keys sorted
+  TFile* fOldFile;
+  TTree* fOldTree;
+  AnitaEventSummary* fOldSummary;
+  std::vector<Key> fKeys;
+
+  // what will replace it
+  TFile* fNewFile;
+  TTree* fNewTree;
+  ULong64_t fNewKeyHi;
+  ULong64_t fNewKeyLo;
+  AnitaEventSummary* fNewSummary;
+  std::vector<Key> fNewKeys; // entry is in the new tree
+
+  Long64_t fNumHits;
+  Long64_t fNumMisses;
+};
+
+#endif
@@ -0,0 +1,78 @@
+#include "SparseReadPlanner.h"
+
+#include "TTree.h"
+#include "TEntryList.h"
+
+#include <algorithm>
+#include <utility>
+#include <set>
+
+SparseReadPlanner::SparseReadPlanner(){
+
+}
+
+
+
+void SparseReadPlanner::plan(TTree* indexedTree, const std::vector<UInt_t>& eventNumbers){
+
+  std::vector<std::pair<Long64_t, UInt_t> > entryEventNumbers;
+  std::set<UInt_t> seen;
+  for(UInt_t i=0; i < eventNumbers.size(); i++){
+    if(!seen.insert(eventNumbers[i]).second){
+      continue;
+    }
+    const Long64_t entry = indexedTree->GetEntryNumberWithIndex(eventNumbers[i]);
+    if(entry >= 0){
+      entryEventNumbers.push_back(std::make_pair(entry, eventNumbers[i]));
+    }
+  }
+  std::sort(entryEventNumbers.begin(), entryEventNumbers.end());
+
+  fEntries.clear();
+  fEventNumbers.clear();
+  fPlanInds.clear();
+  for(UInt_t planInd=0; planInd < entryEventNumbers.size(); planInd++){
+    fEntries.push_back(entryEventNumbers[planInd].first);
+    fEventNumbers.push_back(entryEventNumbers[planInd].second);
+    fPlanInds[entryEventNumbers[planInd].second] = planInd;
+  }
+}
+
+
+
+void SparseReadPlanner::read(const std::vector<TTree*>& trees, const std::function<void(Int_t planInd)>& func,
+			     Long64_t cacheSize) const {
+
+  if(fEntries.size()==0){
+    return;
+  }
+
+  // With an entry list the cache skips baskets that don't have any of our entries in
+  std::vector<TEntryList*> entryLists;
+  for(UInt_t treeInd=0; treeInd < trees.size(); treeInd++){
+    TTree* tree = trees[treeInd];
+    TEntryList* entryList = new TEntryList(tree);
+    for(UInt_t planInd=0; planInd < fEntries.size(); planInd++){
+      entryList->Enter(fEntries[planInd], tree);
+    }
+    tree->SetEntryList(entryList);
+    tree->SetCacheSize(cacheSize);
+    tree->AddBranchToCache("*", true);
+    tree->SetCacheEntryRange(fEntries.front(), fEntries.back() + 1);
+    tree->StopCacheLearningPhase();
+    entryLists.push_back(entryList);
+  }
+
+  for(UInt_t planInd=0; planInd < fEntries.size(); planInd++){
+    for(UInt_t treeInd=0; treeInd < trees.size(); treeInd++){
+      trees[treeInd]->GetEntry(fEntries[planInd]);
+    }
+    func(planInd);
+  }
+
+  for(UInt_t treeInd=0; treeInd < trees.size(); treeInd++){
+    trees[treeInd]->SetEntryList(NULL);
+    trees[treeInd]->SetCacheSize(0);
+    delete entryLists[treeInd];
+  }
+}
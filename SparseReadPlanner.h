@@ -0,0 +1,59 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Reads a scattered set of events from some chains in one pass.
+             The eventNumbers are looked up once, duplicates dropped, and sorted into entry (so file) order.
+             Each chain gets a TEntryList of just those entries and a TTreeCache, so only baskets holding a
+             wanted entry are read and unzipped. The caches prefetch asynchronously if the program has set
+             TFile.AsyncPrefetching, which is process wide and has to be done before the files are opened,
+             so that's left to main().
+             The consumer gets each entry once, in entry order, and can stash what it needs for later.
+*************************************************************************************************************** */
+
+#ifndef SPARSEREADPLANNER_H
+#define SPARSEREADPLANNER_H
+
+#include "Rtypes.h"
+
+#include <vector>
+#include <map>
+#include <functional>
+
+class TTree;
+
+class SparseReadPlanner {
+
+public:
+
+  SparseReadPlanner();
+
+  // indexedTree needs an eventNumber index (e.g. from BuildIndex("eventNumber")),
+  // eventNumbers that aren't in it are left out of the plan
+  void plan(TTree* indexedTree, const std::vector<UInt_t>& eventNumbers);
+
+  // Calls func(planInd) for each planned entry after each tree has read it.
+  // The trees must line up entry by entry (e.g. headTree and eventTree chains of the same runs)
+  void read(const std::vector<TTree*>& trees, const std::function<void(Int_t planInd)>& func,
+	    Long64_t cacheSize = 30000000) const;
+
+  // Index in the plan of eventNumber, or -1 if it wasn't found
+  Int_t find(UInt_t eventNumber) const {
+    std::map<UInt_t, Int_t>::const_iterator it = fPlanInds.find(eventNumber);
+    return it==fPlanInds.end() ? -1 : it->second;
+  }
+
+  size_t size() const {return fEntries.size();}
+  Long64_t getEntry(Int_t planInd) const {return fEntries.at(planInd);}
+  UInt_t getEventNumber(Int_t planInd) const {return fEventNumbers.at(planInd);}
+
+private:
+
+  std::vector<Long64_t> fEntries; // ascending
+  std::vector<UInt_t> fEventNumbers;
+  std::map<UInt_t, Int_t> fPlanInds;
+};
+
+#endif
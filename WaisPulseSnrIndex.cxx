@@ -0,0 +1,320 @@
+#include "WaisPulseSnrIndex.h"
+#include "EventNumberJoin.h"
+#include "NotchFilterBank.h"
+#include "CalEventReader.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TSystem.h"
+#include "TMath.h"
+#include "TGraph.h"
+
+#include "RawAnitaHeader.h"
+#include "UsefulAdu5Pat.h"
+#include "UsefulAnitaEvent.h"
+#include "CrossCorrelator.h"
+
+#include <iostream>
+#include <algorithm>
+
+namespace {
+  const char* snrTreeTitle = "SNR of WAIS divide pulses, coherently summed waveform at the map peak, anita3 notches in the CrossCorrelator";
+
+  bool pulseOrder(const WaisPulseSnrIndex::Pulse& a, const WaisPulseSnrIndex::Pulse& b){
+    return a.eventNumber < b.eventNumber;
+  }
+
+  bool runOrder(const WaisPulseSnrIndex::Pulse& a, const WaisPulseSnrIndex::Pulse& b){
+    return a.run < b.run;
+  }
+}
+
+
+
+WaisPulseSnrIndex::WaisPulseSnrIndex(){
+
+}
+
+
+
+Int_t WaisPulseSnrIndex::deltaTriggerTimeNs(UInt_t triggerTimeNs, UInt_t expectedTriggerTimeNs){
+
+  // both are ns into a second, so a pulse expected at 999999900 might trigger at 100
+  Int_t delta = Int_t(triggerTimeNs) - Int_t(expectedTriggerTimeNs);
+  const Int_t nsPerSecond = 1000000000;
+  if(delta > nsPerSecond/2){
+    delta -= nsPerSecond;
+  }
+  else if(delta < -nsPerSecond/2){
+    delta += nsPerSecond;
+  }
+  return delta;
+}
+
+
+
+void WaisPulseSnrIndex::coherentSnr(CrossCorrelator* cc, UsefulAnitaEvent* usefulEvent, Float_t snr[AnitaPol::kNotAPol]){
+
+  // the same peak finding and coherent sum as reconstruction
+  const Int_t numPeaksCoarse = 1;
+  const Int_t numPeaksFine = 1;
+  const Int_t coherentDeltaPhi = 0;
+  cc->reconstructEvent(usefulEvent, numPeaksCoarse, numPeaksFine);
+  for(Int_t polInd=0; polInd < AnitaPol::kNotAPol; polInd++){
+    AnitaPol::AnitaPol_t pol = (AnitaPol::AnitaPol_t) polInd;
+    Double_t peakValue = 0;
+    Double_t peakPhi = 0;
+    Double_t peakTheta = 0;
+    cc->getFinePeakInfo(pol, 0, peakValue, peakPhi, peakTheta);
+
+    Double_t peakSnr = 0;
+    TGraph* grCoherent = cc->makeUpsampledCoherentlySummedWaveform(pol, peakPhi, peakTheta, coherentDeltaPhi, peakSnr);
+    delete grCoherent;
+    snr[polInd] = peakSnr;
+  }
+}
+
+
+
+Int_t WaisPulseSnrIndex::scanRun(const char* dataDir, Int_t run, Int_t maxDeltaTriggerTimeNs, CrossCorrelator* cc,
+				 std::vector<Pulse>& pulses){
+
+  TString headFileName = TString::Format("%s/run%d/timedHeadFile%dOfflineMask.root", dataDir, run, run);
+  TString gpsFileName = TString::Format("%s/run%d/gpsEvent%d.root", dataDir, run, run);
+  TString calFileName = TString::Format("%s/run%d/calEventFile%d.root", dataDir, run, run);
+  gSystem->ExpandPathName(headFileName);
+  gSystem->ExpandPathName(gpsFileName);
+  gSystem->ExpandPathName(calFileName);
+
+  TFile* headFile = TFile::Open(headFileName);
+  TFile* gpsFile = TFile::Open(gpsFileName);
+  TFile* calFile = TFile::Open(calFileName);
+  TTree* headTree = headFile ? (TTree*) headFile->Get("headTree") : NULL;
+  TTree* gpsTree = gpsFile ? (TTree*) gpsFile->Get("adu5PatTree") : NULL;
+  TTree* calTree = calFile ? (TTree*) calFile->Get("eventTree") : NULL;
+  if(headTree==NULL || gpsTree==NULL || calTree==NULL){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open the files for run " << run << std::endl;
+    delete headFile;
+    delete gpsFile;
+    delete calFile;
+    return 1;
+  }
+
+  RawAnitaHeader* header = NULL;
+  Adu5Pat* pat = NULL;
+  UInt_t gpsEventNumber = 0;
+  CalEventReader calReader;
+  headTree->SetBranchAddress("header", &header);
+  gpsTree->SetBranchAddress("pat", &pat);
+  gpsTree->SetBranchAddress("eventNumber", &gpsEventNumber);
+  if(calReader.setBranchAddress(calTree)!=0){
+    delete headFile;
+    delete gpsFile;
+    delete calFile;
+    return 1;
+  }
+
+  EventNumberJoin join;
+  const Int_t headInd = join.add(headTree, [&](){return header->eventNumber;});
+  const Int_t gpsInd = join.add(gpsTree, [&](){return gpsEventNumber;});
+
+  while(join.next()){
+    join.load(headInd);
+    if(header->getTriggerBitRF()==0){
+      continue;
+    }
+
+    // only the RF triggers need the gps, only WAIS pulses need the waveforms
+    join.load(gpsInd);
+    UsefulAdu5Pat usefulPat(pat);
+    const Int_t deltaNs = deltaTriggerTimeNs(header->triggerTimeNs, usefulPat.getWaisDivideTriggerTimeNs());
+    if(TMath::Abs(deltaNs) >= maxDeltaTriggerTimeNs){
+      continue;
+    }
+
+    // the run's head and event files line up entry by entry
+    calTree->GetEntry(join.getEntry(headInd));
+    UsefulAnitaEvent* usefulEvent = calReader.makeUsefulEvent();
+
+    Pulse pulse;
+    pulse.run = run;
+    pulse.eventNumber = header->eventNumber;
+    pulse.realTime = header->realTime;
+    pulse.deltaTriggerTimeNs = deltaNs;
+    coherentSnr(cc, usefulEvent, pulse.snr);
+    pulses.push_back(pulse);
+
+    delete usefulEvent;
+  }
+
+  delete headFile;
+  delete gpsFile;
+  delete calFile;
+  return 0;
+}
+
+
+
+Int_t WaisPulseSnrIndex::build(const char* dataDir, Int_t firstRun, Int_t lastRun, Int_t maxDeltaTriggerTimeNs){
+
+  const Int_t numRuns = lastRun - firstRun + 1;
+  if(numRuns <= 0){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", no runs between " << firstRun << " and " << lastRun << std::endl;
+    return 1;
+  }
+
+  // Set up like reconstruction's default, notches included
+  CrossCorrelator* cc = new CrossCorrelator();
+  NotchFilterBank::anita3().addTo(cc);
+
+  fPulses.clear();
+  Int_t retVal = 0;
+  for(Int_t run=firstRun; run <= lastRun && retVal==0; run++){
+    std::vector<Pulse> runPulses;
+    retVal = scanRun(dataDir, run, maxDeltaTriggerTimeNs, cc, runPulses);
+    std::cout << "Run " << run << ": " << runPulses.size() << " WAIS pulses" << std::endl;
+    fPulses.insert(fPulses.end(), runPulses.begin(), runPulses.end());
+  }
+  delete cc;
+  return retVal;
+}
+
+
+
+Int_t WaisPulseSnrIndex::writeFile(const char* fileName) const {
+
+  TFile* outFile = new TFile(fileName, "recreate");
+  if(outFile->IsZombie()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open " << fileName << std::endl;
+    delete outFile;
+    return 1;
+  }
+
+  TTree* snrTree = new TTree("waisPulseSnrTree", snrTreeTitle);
+  Pulse pulse;
+  snrTree->Branch("run", &pulse.run);
+  snrTree->Branch("eventNumber", &pulse.eventNumber);
+  snrTree->Branch("realTime", &pulse.realTime);
+  snrTree->Branch("deltaTriggerTimeNs", &pulse.deltaTriggerTimeNs);
+  snrTree->Branch("snrH", &pulse.snr[AnitaPol::kHorizontal]);
+  snrTree->Branch("snrV", &pulse.snr[AnitaPol::kVertical]);
+  for(UInt_t i=0; i < fPulses.size(); i++){
+    pulse = fPulses[i];
+    snrTree->Fill();
+  }
+
+  outFile->Write();
+  outFile->Close();
+  delete outFile;
+  return 0;
+}
+
+
+
+Int_t WaisPulseSnrIndex::readFile(const char* fileName){
+  fPulses.clear();
+  return readPulses(fileName, fPulses);
+}
+
+
+
+Int_t WaisPulseSnrIndex::merge(const char* fileName){
+
+  std::vector<Pulse> pulses;
+  if(readPulses(fileName, pulses)!=0){
+    return 1;
+  }
+
+  // each run should have been scanned by one job
+  for(UInt_t i=0; i < pulses.size(); i++){
+    std::vector<Pulse>::const_iterator it = std::lower_bound(fPulses.begin(), fPulses.end(), pulses[i], runOrder);
+    if(it!=fPulses.end() && it->run==pulses[i].run){
+      std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", run " << pulses[i].run << " in " << fileName
+		<< " is already in the index" << std::endl;
+      return 1;
+    }
+  }
+
+  // stable, so each run's pulses stay in the order they were scanned
+  fPulses.insert(fPulses.end(), pulses.begin(), pulses.end());
+  std::stable_sort(fPulses.begin(), fPulses.end(), runOrder);
+  return 0;
+}
+
+
+
+Int_t WaisPulseSnrIndex::readPulses(const char* fileName, std::vector<Pulse>& pulses){
+
+  TFile* inFile = TFile::Open(fileName);
+  TTree* snrTree = inFile ? (TTree*) inFile->Get("waisPulseSnrTree") : NULL;
+  if(snrTree==NULL){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to find waisPulseSnrTree in " << fileName << std::endl;
+    delete inFile;
+    return 1;
+  }
+  if(TString(snrTree->GetTitle())!=snrTreeTitle){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", " << fileName << " was made with a different SNR ("
+	      << snrTree->GetTitle() << "), re-run scanWaisPulseSnr" << std::endl;
+    inFile->Close();
+    delete inFile;
+    return 1;
+  }
+
+  Pulse pulse;
+  snrTree->SetBranchAddress("run", &pulse.run);
+  snrTree->SetBranchAddress("eventNumber", &pulse.eventNumber);
+  snrTree->SetBranchAddress("realTime", &pulse.realTime);
+  snrTree->SetBranchAddress("deltaTriggerTimeNs", &pulse.deltaTriggerTimeNs);
+  snrTree->SetBranchAddress("snrH", &pulse.snr[AnitaPol::kHorizontal]);
+  snrTree->SetBranchAddress("snrV", &pulse.snr[AnitaPol::kVertical]);
+
+  const Long64_t nEntries = snrTree->GetEntries();
+  pulses.resize(nEntries);
+  for(Long64_t entry=0; entry < nEntries; entry++){
+    snrTree->GetEntry(entry);
+    pulses[entry] = pulse;
+  }
+
+  inFile->Close();
+  delete inFile;
+  return 0;
+}
+
+
+
+Int_t WaisPulseSnrIndex::select(AnitaPol::AnitaPol_t pol, Double_t minSnr, Double_t maxSnr, Int_t maxDeltaTriggerTimeNs,
+				Int_t numPulses, std::vector<UInt_t>& eventNumbers) const {
+
+  std::vector<Pulse> passing;
+  for(UInt_t i=0; i < fPulses.size(); i++){
+    const Pulse& pulse = fPulses[i];
+    if(pulse.snr[pol] >= minSnr && pulse.snr[pol] < maxSnr && TMath::Abs(pulse.deltaTriggerTimeNs) < maxDeltaTriggerTimeNs){
+      passing.push_back(pulse);
+    }
+  }
+  if((Long64_t)passing.size() < numPulses){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", only " << passing.size() << " pulses with "
+	      << minSnr << " <= SNR < " << maxSnr << ", wanted " << numPulses << std::endl;
+    return 1;
+  }
+  std::sort(passing.begin(), passing.end(), pulseOrder);
+
+  // spread through the runs, like the hand picked list
+  eventNumbers.clear();
+  for(Int_t i=0; i < numPulses; i++){
+    eventNumbers.push_back(passing[(Long64_t(i)*passing.size())/numPulses].eventNumber);
+  }
+  return 0;
+}
+
+
+
+Long64_t WaisPulseSnrIndex::count(AnitaPol::AnitaPol_t pol, Double_t minSnr, Double_t maxSnr) const {
+  Long64_t n = 0;
+  for(UInt_t i=0; i < fPulses.size(); i++){
+    if(fPulses[i].snr[pol] >= minSnr && fPulses[i].snr[pol] < maxSnr){
+      n++;
+    }
+  }
+  return n;
+}
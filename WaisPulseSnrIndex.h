@@ -0,0 +1,75 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             The SNR of every WAIS divide pulse in a set of runs (steps 2 and 3 of the blinding), so picking
+             fake pulses is a query rather than a day of offline work.
+             A WAIS pulse is an RF trigger within maxDeltaTriggerTimeNs of when a WAIS pulse should arrive.
+             The SNR is the one in the step 2 plot, i.e. what reconstruction puts in coherent[pol][0].snr:
+             CrossCorrelator's coherently summed waveform at the fine map peak, after the anita3() notches.
+             The CrossCorrelator's FFTs and the calibration can't be shared between threads, so a scan runs on
+             one thread. To go faster, scan ranges of runs in separate processes and merge() the files.
+             Saved in a small ROOT file (waisPulseSnrTree) that's also handy for plotting.
+*************************************************************************************************************** */
+
+#ifndef WAISPULSESNRINDEX_H
+#define WAISPULSESNRINDEX_H
+
+#include "Rtypes.h"
+#include "AnitaConventions.h"
+
+#include <vector>
+
+class CrossCorrelator;
+class UsefulAnitaEvent;
+
+class WaisPulseSnrIndex {
+
+public:
+
+  struct Pulse {
+    Int_t run;
+    UInt_t eventNumber;
+    UInt_t realTime;
+    Int_t deltaTriggerTimeNs; // triggerTimeNs minus the expected WAIS trigger time, in (-0.5, 0.5] s
+    Float_t snr[AnitaPol::kNotAPol];
+  };
+
+  WaisPulseSnrIndex();
+
+  // Scans dataDir/run%d/{timedHeadFile%dOfflineMask,gpsEvent%d,calEventFile%d}.root, keeping pulses in run order
+  Int_t build(const char* dataDir, Int_t firstRun, Int_t lastRun, Int_t maxDeltaTriggerTimeNs = 2000);
+
+  Int_t writeFile(const char* fileName) const;
+  Int_t readFile(const char* fileName);
+
+  // Adds the pulses in another index file, keeping run order, returns 1 if any of its runs are already here
+  Int_t merge(const char* fileName);
+
+  // numPulses evenly spaced (in eventNumber order) pulses with minSnr <= snr[pol] < maxSnr and
+  // |deltaTriggerTimeNs| < maxDeltaTriggerTimeNs, returns 1 if there aren't enough
+  Int_t select(AnitaPol::AnitaPol_t pol, Double_t minSnr, Double_t maxSnr, Int_t maxDeltaTriggerTimeNs,
+	       Int_t numPulses, std::vector<UInt_t>& eventNumbers) const;
+
+  // How many pulses have minSnr <= snr[pol] < maxSnr
+  Long64_t count(AnitaPol::AnitaPol_t pol, Double_t minSnr, Double_t maxSnr) const;
+
+  size_t size() const {return fPulses.size();}
+  const Pulse& getPulse(Int_t i) const {return fPulses.at(i);}
+
+  // triggerTimeNs - expectedTriggerTimeNs, wrapped across the second boundary
+  static Int_t deltaTriggerTimeNs(UInt_t triggerTimeNs, UInt_t expectedTriggerTimeNs);
+
+private:
+
+  static void coherentSnr(CrossCorrelator* cc, UsefulAnitaEvent* usefulEvent, Float_t snr[AnitaPol::kNotAPol]);
+  static Int_t readPulses(const char* fileName, std::vector<Pulse>& pulses);
+  static Int_t scanRun(const char* dataDir, Int_t run, Int_t maxDeltaTriggerTimeNs, CrossCorrelator* cc,
+		       std::vector<Pulse>& pulses);
+
+  std::vector<Pulse> fPulses;
+};
+
+#endif
@@ -0,0 +1,30 @@
+#include "WaveformSnr.h"
+
+#include "TMath.h"
+
+
+
+Double_t WaveformSnr::get(const Double_t* volts, Int_t numPoints){
+
+  const Int_t numNoise = numPoints/4;
+  if(numNoise < 2){
+    return 0;
+  }
+
+  Double_t sum = 0;
+  Double_t sum2 = 0;
+  for(Int_t samp=0; samp < numNoise; samp++){
+    sum += volts[samp];
+    sum2 += volts[samp]*volts[samp];
+  }
+  const Double_t mean = sum/numNoise;
+  const Double_t rms = TMath::Sqrt(TMath::Max(0., sum2/numNoise - mean*mean));
+
+  Double_t maxY = volts[0];
+  Double_t minY = volts[0];
+  for(Int_t samp=1; samp < numPoints; samp++){
+    maxY = TMath::Max(maxY, volts[samp]);
+    minY = TMath::Min(minY, volts[samp]);
+  }
+  return rms > 0 ? 0.5*(maxY - minY)/rms : 0;
+}
@@ -0,0 +1,25 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             A quick SNR straight from an array of samples: half the peak to peak over the rms of the first
+             quarter, which is taken to be noise. Used by CoherentSumKernel for its summed waveforms.
+             Not the same number as CrossCorrelator's coherent sum SNR (that's what WaisPulseSnrIndex uses).
+*************************************************************************************************************** */
+
+#ifndef WAVEFORMSNR_H
+#define WAVEFORMSNR_H
+
+#include "Rtypes.h"
+
+class WaveformSnr {
+
+public:
+
+  // 0 if there are too few samples or the first quarter is flat
+  static Double_t get(const Double_t* volts, Int_t numPoints);
+};
+
+#endif
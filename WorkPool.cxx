@@ -0,0 +1,56 @@
+#include "WorkPool.h"
+
+#include "TROOT.h"
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <vector>
+#include <cstdlib>
+
+void WorkPool::process(Long64_t numTasks, Int_t numWorkers, const std::function<void(Long64_t task, Int_t workerInd)>& func){
+
+  if(numWorkers < 1){
+    numWorkers = 1;
+  }
+  if(numWorkers > numTasks){
+    numWorkers = numTasks;
+  }
+
+  if(numWorkers <= 1){
+    for(Long64_t task=0; task < numTasks; task++){
+      func(task, 0);
+    }
+    return;
+  }
+
+  ROOT::EnableThreadSafety();
+
+  std::atomic<Long64_t> nextTask(0);
+  std::vector<std::thread> workers;
+  for(Int_t workerInd=0; workerInd < numWorkers; workerInd++){
+    workers.push_back(std::thread([&, workerInd](){
+	  for(Long64_t task = nextTask++; task < numTasks; task = nextTask++){
+	    func(task, workerInd);
+	  }
+	}));
+  }
+  for(UInt_t i=0; i < workers.size(); i++){
+    workers.at(i).join();
+  }
+}
+
+
+Int_t WorkPool::parseNumWorkers(const char* arg){
+
+  Int_t numWorkers = arg ? atoi(arg) : 0;
+  if(numWorkers <= 0){
+    numWorkers = std::thread::hardware_concurrency();
+    std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", couldn't parse number of workers from "
+	      << (arg ? arg : "(null)") << ", using " << numWorkers << std::endl;
+  }
+  if(numWorkers <= 0){
+    numWorkers = 1;
+  }
+  return numWorkers;
+}
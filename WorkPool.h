@@ -0,0 +1,27 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Minimal thread pool for handing independent tasks (runs, trials...) to worker threads.
+*************************************************************************************************************** */
+
+#ifndef WORKPOOL_H
+#define WORKPOOL_H
+
+#include "Rtypes.h"
+#include <functional>
+
+namespace WorkPool {
+
+  // Calls process(task, workerInd) for every task in [0, numTasks).
+  // Idle workers grab the next unclaimed task, so a few long tasks don't hold up the rest.
+  // ROOT thread safety is switched on if numWorkers > 1, each task must open its own TFiles.
+  void process(Long64_t numTasks, Int_t numWorkers, const std::function<void(Long64_t task, Int_t workerInd)>& func);
+
+  // Parses the N in "-j N", falls back to the number of cores if N isn't a positive number
+  Int_t parseNumWorkers(const char* arg);
+}
+
+#endif
@@ -0,0 +1,93 @@
+#include "WriterProfile.h"
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TBranch.h"
+#include "Compression.h"
+
+#include <iostream>
+#include <cstdlib>
+
+WriterProfile::WriterProfile(EProfile profile){
+  fProfile = profile;
+}
+
+
+const char* WriterProfile::getName(EProfile profile){
+  switch(profile){
+  case kDefault:
+    return "default";
+  case kFastWrite:
+    return "fast";
+  case kArchival:
+    return "archival";
+  case kReadOptimised:
+    return "read";
+  default:
+    return "unknown";
+  }
+}
+
+
+WriterProfile WriterProfile::fromName(const char* name){
+
+  TString profileName = name ? name : "";
+  for(Int_t profileInd=0; profileInd < kNumProfiles; profileInd++){
+    if(profileName==getName((EProfile) profileInd)){
+      return WriterProfile((EProfile) profileInd);
+    }
+  }
+  std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", unknown writer profile " << profileName.Data()
+	    << ", using " << getName(kDefault) << std::endl;
+  return WriterProfile(kDefault);
+}
+
+
+WriterProfile WriterProfile::fromEnvironment(){
+  const char* name = getenv("BLINDING_WRITER_PROFILE");
+  return name ? fromName(name) : WriterProfile(kDefault);
+}
+
+
+void WriterProfile::applyTo(TFile* file) const {
+  switch(fProfile){
+  case kFastWrite:
+  case kReadOptimised:
+    file->SetCompressionSettings(ROOT::CompressionSettings(ROOT::kLZ4, 4));
+    break;
+  case kArchival:
+    file->SetCompressionSettings(ROOT::CompressionSettings(ROOT::kLZMA, 8));
+    break;
+  default:
+    break;
+  }
+}
+
+
+void WriterProfile::applyTo(TTree* tree) const {
+
+  if(fProfile==kDefault){
+    return;
+  }
+
+  // Branches pick up the file's compression when they're made, but make sure
+  // trees cloned from somewhere else follow the file too
+  TFile* file = tree->GetCurrentFile();
+  if(file){
+    TObjArray* branches = tree->GetListOfBranches();
+    for(Int_t branchInd=0; branchInd < branches->GetEntries(); branchInd++){
+      TBranch* branch = (TBranch*) branches->At(branchInd);
+      branch->SetCompressionSettings(file->GetCompressionSettings());
+    }
+  }
+
+  if(fProfile==kReadOptimised){
+    // fewer, bigger reads and whole clusters of entries in one go
+    tree->SetBasketSize("*", 256000);
+    tree->SetAutoFlush(-100000000); // negative means bytes
+  }
+  else if(fProfile==kArchival){
+    // bigger baskets compress better
+    tree->SetBasketSize("*", 128000);
+  }
+}
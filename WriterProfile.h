@@ -0,0 +1,51 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Output settings (compression, basket size, auto-flush) for the trees the binaries write.
+             Pick one with the environment variable BLINDING_WRITER_PROFILE=default|fast|archival|read
+             or with -p where a binary supports it. benchmarkWriterProfiles measures the trade-offs.
+*************************************************************************************************************** */
+
+#ifndef WRITERPROFILE_H
+#define WRITERPROFILE_H
+
+#include "Rtypes.h"
+
+class TFile;
+class TTree;
+
+class WriterProfile {
+
+public:
+
+  enum EProfile {
+    kDefault,       // whatever ROOT does by default
+    kFastWrite,     // LZ4, cheap to compress
+    kArchival,      // LZMA, smallest files
+    kReadOptimised, // LZ4 with big baskets and clusters, cheapest to read back many times
+    kNumProfiles
+  };
+
+  WriterProfile(EProfile profile = kDefault);
+
+  static WriterProfile fromName(const char* name);
+  static WriterProfile fromEnvironment();
+
+  // call on the file before creating any trees in it
+  void applyTo(TFile* file) const;
+  // call on the tree after creating all its branches
+  void applyTo(TTree* tree) const;
+
+  EProfile getProfile() const {return fProfile;}
+  const char* getName() const {return getName(fProfile);}
+  static const char* getName(EProfile profile);
+
+private:
+
+  EProfile fProfile;
+};
+
+#endif
@@ -0,0 +1,153 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Writes the header tree of one run (and optionally a reconstruction eventSummaryTree) with each
+             WriterProfile, and reports write speed, file size and read-back speed for each.
+*************************************************************************************************************** */
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TROOT.h"
+#include "TSystem.h"
+#include "TStopwatch.h"
+
+#include "WriterProfile.h"
+#include "DataDirectory.h"
+
+#include <iostream>
+#include <iomanip>
+
+struct BenchmarkResult {
+  Double_t uncompressedMB;
+  Double_t fileMB;
+  Double_t writeMBPerSec;
+  Double_t readMBPerSec;
+};
+
+BenchmarkResult benchmarkProfile(TTree* memTree, const WriterProfile& profile, const TString& outFileName);
+Int_t benchmarkTree(const char* fileName, const char* treeName, Bool_t keepFiles);
+
+
+int main(int argc, char* argv[]){
+
+  if(argc < 2 || argc > 4){
+    std::cerr << "Usage: " << argv[0] << " [run] (reconstructionFile.root) (--keep)" << std::endl;
+    return 1;
+  }
+  const Int_t run = atoi(argv[1]);
+  Bool_t keepFiles = false;
+  TString summaryFileName = "";
+  for(int i=2; i < argc; i++){
+    if(TString(argv[i])=="--keep"){
+      keepFiles = true;
+    }
+    else{
+      summaryFileName = argv[i];
+    }
+  }
+
+  TString headFileName = DataDirectory::getHeadFileName(run);
+  Int_t retVal = benchmarkTree(headFileName, "headTree", keepFiles);
+
+  if(summaryFileName.Length() > 0){
+    retVal += benchmarkTree(summaryFileName, "eventSummaryTree", keepFiles);
+  }
+
+  return retVal;
+}
+
+
+
+Int_t benchmarkTree(const char* fileName, const char* treeName, Bool_t keepFiles){
+
+  TFile* inFile = TFile::Open(fileName);
+  TTree* inTree = inFile ? (TTree*) inFile->Get(treeName) : NULL;
+  if(inTree==NULL){
+    std::cerr << "Unable to find " << treeName << " in " << fileName << ". Giving up." << std::endl;
+    delete inFile;
+    return 1;
+  }
+
+  // Copy everything into memory first, so the write timing doesn't include reading the input
+  gROOT->cd();
+  TTree* memTree = inTree->CloneTree(-1);
+
+  std::cout << std::endl << treeName << " from " << fileName << ", " << memTree->GetEntries() << " entries" << std::endl;
+  std::cout << std::setw(10) << "profile" << std::setw(16) << "raw size (MB)" << std::setw(16) << "file size (MB)"
+	    << std::setw(16) << "write (MB/s)" << std::setw(16) << "read (MB/s)" << std::endl;
+
+  for(Int_t profileInd=0; profileInd < WriterProfile::kNumProfiles; profileInd++){
+    WriterProfile profile((WriterProfile::EProfile) profileInd);
+    TString outFileName = TString::Format("benchmark_%s_%s.root", treeName, profile.getName());
+
+    BenchmarkResult r = benchmarkProfile(memTree, profile, outFileName);
+
+    std::cout << std::setw(10) << profile.getName() << std::fixed << std::setprecision(1)
+	      << std::setw(16) << r.uncompressedMB << std::setw(16) << r.fileMB
+	      << std::setw(16) << r.writeMBPerSec << std::setw(16) << r.readMBPerSec << std::endl;
+
+    if(!keepFiles){
+      gSystem->Unlink(outFileName);
+    }
+  }
+
+  delete memTree;
+  inFile->Close();
+  delete inFile;
+
+  return 0;
+}
+
+
+
+BenchmarkResult benchmarkProfile(TTree* memTree, const WriterProfile& profile, const TString& outFileName){
+
+  BenchmarkResult r;
+  TStopwatch watch;
+
+  //*************************************************************************
+  // Write
+  //*************************************************************************
+
+  watch.Start(true);
+  TFile* outFile = new TFile(outFileName, "recreate");
+  profile.applyTo(outFile);
+  TTree* outTree = memTree->CloneTree(0);
+  profile.applyTo(outTree);
+  outTree->CopyEntries(memTree);
+  r.uncompressedMB = 1e-6*outTree->GetTotBytes();
+  outFile->Write();
+  outFile->Close();
+  watch.Stop();
+  delete outFile;
+  r.writeMBPerSec = watch.RealTime() > 0 ? r.uncompressedMB/watch.RealTime() : 0;
+
+  Long_t id, flags, modtime;
+  Long64_t size;
+  gSystem->GetPathInfo(outFileName, &id, &size, &flags, &modtime);
+  r.fileMB = 1e-6*size;
+
+  //*************************************************************************
+  // Read it all back, like the downstream analysis would
+  //*************************************************************************
+
+  // The file was only just written so it's probably still in the page cache,
+  // this mostly measures decompression and deserialisation
+
+  watch.Start(true);
+  TFile* readFile = TFile::Open(outFileName);
+  TTree* readTree = (TTree*) readFile->Get(memTree->GetName());
+  const Long64_t nEntries = readTree->GetEntries();
+  for(Long64_t entry=0; entry < nEntries; entry++){
+    readTree->GetEntry(entry);
+  }
+  readFile->Close();
+  watch.Stop();
+  delete readFile;
+  r.readMBPerSec = watch.RealTime() > 0 ? r.uncompressedMB/watch.RealTime() : 0;
+
+  return r;
+}
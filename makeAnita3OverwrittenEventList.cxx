@@ -13,6 +13,12 @@
 #include "TRandom3.h"
 #include "TLegend.h"
 #include "TApplication.h"
+#include "TCanvas.h"
+#include "TROOT.h"
+#include "TH1D.h"
+#include "TH2D.h"
+#include "TMath.h"
+#include "TNamed.h"
 
 #include "RawAnitaHeader.h"
 #include "UsefulAdu5Pat.h"
@@ -28,22 +34,101 @@
 #include "FancyFFTs.h"
 #include "RootTools.h"
 
+#include "MinBiasCandidatePool.h"
+#include "EventNumberSet.h"
+#include "RealTimeIndex.h"
+#include "ContinentRaster.h"
+#include "GeolocationBatch.h"
+#include "FlightTrack.h"
+#include "BlindingSelection.h"
+#include "CounterRandom.h"
+#include "WorkPool.h"
+#include "DataDirectory.h"
+#include "Instrumentation.h"
+
+Instrumentation::Timer realTimeIndexTimer("realTime index");
+Instrumentation::Timer poolTimer("candidate pool");
+Instrumentation::Timer selectionTimer("selection");
+Instrumentation::Timer monteCarloTimer("monte carlo");
+Instrumentation::Counter candidatesCounter("candidates tried");
+
+Int_t runMonteCarlo(Long64_t numTrials, UInt_t seed, const MinBiasCandidatePool& pool,
+		    const ContinentRaster* continentRaster, const std::vector<BlindingSelection::FakePulsePeak>& peaks,
+		    UInt_t firstRealTime, UInt_t lastRealTime, Int_t numWorkers, const char* outFileName);
+
+Int_t writeCandidateScores(const char* fileName, const MinBiasCandidatePool& pool, const GeolocationBatch& geolocator,
+			   const std::vector<BlindingSelection::FakePulsePeak>& peaks,
+			   const std::vector<BlindingSelection::SelectedEvent>& selectedEvents);
+
 
 int main(int argc, char* argv[]){
 
   AnitaVersion::set(3);
 
-  TApplication* theApp = new TApplication(argv[0], &argc, argv);
-
   // Runs near WAIS divide
   // const Int_t firstRun = 331;
   // const Int_t lastRun = 354;
-  if(argc!=3){
-    std::cerr << "Usage: " << argv[0] << " [firstRun] [lastRun]" << std::endl;
+  std::vector<Int_t> runArgs;
+  Int_t numWorkers = 1;
+  Bool_t scoreAll = false;
+  TString mapFileName = "";
+  Long64_t numTrials = 0;
+  Bool_t checkRealTimeIndex = false;
+  Bool_t useContinentRaster = false;
+  for(int i=1; i < argc; i++){
+    TString arg = argv[i];
+    if(arg=="-j" && i+1 < argc){
+      numWorkers = WorkPool::parseNumWorkers(argv[i+1]);
+      i++;
+    }
+    else if(arg=="--score-all"){
+      scoreAll = true;
+    }
+    else if(arg=="--monte-carlo" && i+1 < argc){
+      numTrials = TString(argv[i+1]).Atoll();
+      i++;
+    }
+    else if(arg=="--continent-raster"){
+      useContinentRaster = true;
+    }
+    else if(arg=="--check-realtime-index"){
+      checkRealTimeIndex = true;
+    }
+    else if(arg=="-o" && i+1 < argc){
+      mapFileName = argv[i+1];
+      i++;
+    }
+    else if(arg.IsDigit()){
+      runArgs.push_back(arg.Atoi());
+    }
+    else{
+      runArgs.clear();
+      break;
+    }
+  }
+  if(runArgs.size()!=2){
+    std::cerr << "Usage: " << argv[0] << " [firstRun] [lastRun] (-j numThreads) (--score-all) (-o map.png) (--monte-carlo numTrials) (--continent-raster) (--check-realtime-index)" << std::endl;
+    std::cerr << "-o saves the map of inserted events to a file and exits, rather than opening a window" << std::endl;
+    std::cerr << "--score-all also writes every acceptable candidate for each fake pulse to candidateScores_[firstRun]_[lastRun].root" << std::endl;
+    std::cerr << "--monte-carlo repeats the selection numTrials times with independent random numbers and writes "
+	      << "histograms of the results to blindingMonteCarlo_[firstRun]_[lastRun].root, "
+	      << "anita3OverwrittenEventInfo.txt is left alone" << std::endl;
+    std::cerr << "--continent-raster answers most continent checks from continentRaster.dat, which is quicker "
+	      << "but can disagree with RampdemReader right at the coast, so the selection isn't guaranteed to be the same" << std::endl;
+    std::cerr << "--check-realtime-index compares the cached realTime index with headChain->BuildIndex(\"realTime\") "
+	      << "for every second and exits, it needs the memory the cache saves so use it on a few runs" << std::endl;
     return 1;
   }
-  const Int_t firstRun = atoi(argv[1]);
-  const Int_t lastRun = atoi(argv[2]);
+  const Int_t firstRun = runArgs.at(0);
+  const Int_t lastRun = runArgs.at(1);
+  const Bool_t headless = mapFileName.Length() > 0 || numTrials > 0;
+  TApplication* theApp = NULL;
+  if(headless){
+    gROOT->SetBatch(true);
+  }
+  else{
+    theApp = new TApplication(argv[0], &argc, argv);
+  }
 
   //*************************************************************************
   // Set up input
@@ -53,15 +138,26 @@ int main(int argc, char* argv[]){
   TChain* gpsChain = new TChain("adu5PatTree");
   TChain* decimated = new TChain("headTree");
 
+  // Replaces headChain->BuildIndex("realTime"), the index for each run is saved in DataDirectory::getCacheDirectory()
+  RealTimeIndex realTimeIndex;
+
   for(Int_t run=firstRun; run<=lastRun; run++){
     if(run < 257 || run > 263){
-      TString fileName = TString::Format("~/UCL/ANITA/flight1415/root/run%d/timedHeadFile%dOfflineMask.root", run, run);
+      TString fileName = DataDirectory::getHeadFileName(run);
       headChain->Add(fileName);
 
-      fileName = TString::Format("~/UCL/ANITA/flight1415/root/run%d/gpsEvent%d.root", run, run);
+      TString indexFileName = DataDirectory::getRealTimeIndexFileName(run);
+      {
+	Instrumentation::ScopedTimer t(realTimeIndexTimer);
+	if(realTimeIndex.addRun(run, fileName, indexFileName)!=0){
+	  return 1;
+	}
+      }
+
+      fileName = DataDirectory::getGpsFileName(run);
       gpsChain->Add(fileName);
 
-      fileName = TString::Format("~/UCL/ANITA/flight1415/root/run%d/decimatedHeadFile%d.root", run, run);
+      fileName = DataDirectory::getDecimatedHeadFileName(run);
       decimated->Add(fileName);
     }
   }
@@ -69,22 +165,22 @@ int main(int argc, char* argv[]){
 
   RawAnitaHeader* header = NULL;
   headChain->SetBranchAddress("header", &header);
-  headChain->BuildIndex("realTime");
-  decimated->BuildIndex("eventNumber");
-
-  Adu5Pat* pat = NULL;
-  gpsChain->SetBranchAddress("pat", &pat);
 
   const int numPulses=50;
 
-  std::ofstream outFile("anita3OverwrittenEventInfo.txt", std::ofstream::out);
-  outFile << "eventNumber\tfakeTreeEntry" << std::endl;
-
   TFile* fReco = OutputConvention::getFile("reconstruction_*");
   TTree* tReco = (TTree*) fReco->Get("eventSummaryTree");
   AnitaEventSummary* summary = NULL;
   tReco->SetBranchAddress("eventSummary", &summary);
 
+  // The selection only needs the peak direction of each fake pulse
+  std::vector<BlindingSelection::FakePulsePeak> peaks(numPulses);
+  for(Int_t fakeTreeEntry=0; fakeTreeEntry < numPulses; fakeTreeEntry++){
+    tReco->GetEntry(fakeTreeEntry);
+    peaks.at(fakeTreeEntry).phi = summary->peak[AnitaPol::kVertical][0].phi;
+    peaks.at(fakeTreeEntry).theta = summary->peak[AnitaPol::kVertical][0].theta;
+  }
+
 
   // Now for version 3 of the blinding, we will divide the flight into segments of time
   // rather than segments of eventNumber...
@@ -94,107 +190,86 @@ int main(int argc, char* argv[]){
   UInt_t lastRealTime = header->realTime;
   // std::cout << firstRealTime << "\t" << lastRealTime << "\t" << lastRealTime - firstRealTime << std::endl;
 
+  if(checkRealTimeIndex){
+    const Long64_t numDifferent = realTimeIndex.compareWithTreeIndex(headChain, firstRealTime, lastRealTime);
+    std::cout << "The realTime index and TTreeIndex differ in " << numDifferent << " of "
+	      << lastRealTime - firstRealTime + 1 << " seconds, " << realTimeIndex.getNumOverlapping()
+	      << " seconds are in more than one run" << std::endl;
+    return numDifferent==0 ? 0 : 1;
+  }
+
+  // Everything the selection needs to know about each second of the flight, read in one pass.
+  // Replaces a random GetEntryNumberWithIndex + headChain/gpsChain/decimated lookup per try.
+  // The decimated eventNumbers are cached, delete decimatedEventNumbers_*.dat in the cache directory if the decimated files change.
+  EventNumberSet decimatedEventNumbers;
+  MinBiasCandidatePool pool;
+  {
+    Instrumentation::ScopedTimer t(poolTimer);
+    TString decimatedFileName = DataDirectory::getDecimatedEventNumbersFileName(firstRun, lastRun);
+    if(decimatedEventNumbers.loadOrBuild(decimatedFileName, decimated)!=0){
+      return 1;
+    }
+    if(pool.fill(headChain, gpsChain, realTimeIndex, decimatedEventNumbers, firstRealTime, lastRealTime)!=0){
+      return 1;
+    }
+  }
+
+  // Off by default, the raster can disagree with RampdemReader::isOnContinent near the coast
+  ContinentRaster continentRaster;
+  if(useContinentRaster && continentRaster.loadOrBuild("continentRaster.dat", numWorkers)!=0){
+    return 1;
+  }
+  const ContinentRaster* raster = useContinentRaster ? &continentRaster : NULL;
+
   UInt_t seed = 29348756; // mashed keyboard with hands
   // UInt_t seed = 13986513; // mashed keyboard with hands
   // UInt_t seed = 0;
-  TRandom3 rnd(seed);
 
-  // don't print this number on the final go...
-  const int N = rnd.Uniform(10, 15);
-  // const int N = 10;
-
-  std::vector<Int_t> fakeTreeEntries;
-  std::vector<Int_t> fakeTreeEntriesAvailable(numPulses, 1);
-  for(int i=0; i < N; i++){
-
-    Int_t fakeTreeEntry = -1;
-    bool unusedEntry=false;
-    while(unusedEntry==false){
-
-      Int_t tryThisEntry = rnd.Uniform(0, numPulses);
-      if(fakeTreeEntriesAvailable.at(tryThisEntry) == 1){
-	fakeTreeEntry = tryThisEntry;
-	fakeTreeEntriesAvailable.at(tryThisEntry) = 0;
-	unusedEntry = true;
-      }
-    }
-    fakeTreeEntries.push_back(fakeTreeEntry);
+  if(numTrials > 0){
+    TString mcFileName = TString::Format("blindingMonteCarlo_%d_%d.root", firstRun, lastRun);
+    return runMonteCarlo(numTrials, seed, pool, raster, peaks, firstRealTime, lastRealTime, numWorkers, mcFileName);
   }
-  Int_t selectedEvents = 0;
 
+  //*************************************************************************
+  // The real selection
+  //*************************************************************************
 
-  // Long64_t nEntries = headChain->GetEntries();
+  // Where candidates would reconstruct, tried in batches across threads
+  GeolocationBatch geolocator(pool, raster, numWorkers);
+  const Int_t batchSize = numWorkers > 1 ? 1024*numWorkers : 64;
 
-  // now loop over number of selected blinded pulses, and place them
+  TRandom3 rnd(seed);
+  std::vector<BlindingSelection::SelectedEvent> selectedEvents;
+  {
+    Instrumentation::ScopedTimer t(selectionTimer);
+    if(BlindingSelection::select(rnd, pool, geolocator, peaks, firstRealTime, lastRealTime, batchSize, selectedEvents)!=0){
+      std::cerr << "Something seems wrong here. I'm quitting!" << std::endl;
+      return 1;
+    }
+  }
+
+  // don't print this number on the final go...
+  const int N = selectedEvents.size();
+
+  std::ofstream outFile("anita3OverwrittenEventInfo.txt", std::ofstream::out);
+  outFile << "eventNumber\tfakeTreeEntry" << std::endl;
 
   TGraphAntarctica* grBlindRecoPosition = new TGraphAntarctica();
   TGraphAntarctica* grAnitaPat = new TGraphAntarctica();
   std::vector<TGraphAntarctica*> grConnectors;
-  Double_t eventBearing = -1;
+  Adu5Pat* pat = new Adu5Pat();
   // ProgressBar p(N);
   for(Long64_t i=0; i < N; i++){
 
+    const BlindingSelection::SelectedEvent& selected = selectedEvents.at(i);
+    Int_t fakeTreeEntry = selected.fakeTreeEntry;
+    candidatesCounter.add(selected.numTries);
 
-
-    // get the fake event
-    Int_t fakeTreeEntry = fakeTreeEntries.at(selectedEvents);
-    tReco->GetEntry(fakeTreeEntry);
-
-    Int_t isDec = 1;
-    Int_t isMinBias = 0;
-
-    int numWhile = 0;
-
-    bool onContinent = false;
-    bool southFacingEvent = false;
-
-    Double_t sourceLon, sourceLat, sourceAltitude;
-
-    const int crazyNumber = 1000000;
-    while(isDec > -1 || isMinBias <= 0 || !onContinent || !southFacingEvent){
-
-      // Pick any event from within the time window
-      UInt_t randomTime = rnd.Uniform(firstRealTime, lastRealTime);
-      Int_t entry = headChain->GetEntryNumberWithIndex(randomTime);
-
-      headChain->GetEntry(entry);
-      isDec = decimated->GetEntryNumberWithIndex(header->eventNumber);
-      isMinBias = header->getTriggerBitSoftExt();
-
-
-
-      // Now check if reconstructs to the continent
-      gpsChain->GetEntry(entry);
-      // std::cout << gpsBytes << std::endl;
-      UsefulAdu5Pat usefulPat(pat);
-
-
-      Double_t phiWave = summary->peak[AnitaPol::kVertical][0].phi*TMath::DegToRad();
-      Double_t thetaWave = summary->peak[AnitaPol::kVertical][0].theta*TMath::DegToRad();
-      int retVal = usefulPat.getSourceLonAndLatAtAlt(phiWave, -thetaWave, sourceLon, sourceLat, sourceAltitude);
-
-      if(retVal!=1){
-	onContinent = false;
-      }
-      else{
-	// skip events that don't reconstruct to continent
-	onContinent = RampdemReader::isOnContinent(sourceLon, sourceLat);
-      }
-
-      eventBearing = RootTools::getDeltaAngleDeg(pat->heading, summary->peak[AnitaPol::kVertical][0].phi);
-      southFacingEvent = TMath::Abs(eventBearing) > 135;
-      std::cout << eventBearing << "\t" << pat->heading << "\t" << summary->peak[AnitaPol::kVertical][0].phi << std::endl;
-
-
-      // std::cout << "In while loop " << isDec << "\t" << isMinBias << "\t" << onContinent << std::endl;
-
-      if(numWhile >= crazyNumber){
-	std::cerr << "Something seems wrong here. I'm quitting!" << std::endl;
-	return 1;
-      }
-      numWhile++;
-
-    }
+    UInt_t candidateEventNumber = pool.getEventNumber(selected.candidateInd);
+    pool.getPat(selected.candidateInd, pat);
+    Double_t sourceLon = selected.result.sourceLon;
+    Double_t sourceLat = selected.result.sourceLat;
+    Double_t eventBearing = selected.result.eventBearing;
 
     grBlindRecoPosition->SetPoint(grBlindRecoPosition->GetN(), sourceLon, sourceLat);
     grAnitaPat->SetPoint(grAnitaPat->GetN(), pat->longitude, pat->latitude);
@@ -213,27 +288,33 @@ int main(int argc, char* argv[]){
     std::cout << "ANITA at " << pat->longitude << "\t" << pat->latitude << "\t" << 1e-3*pat->altitude << std::endl;
     std::cout << "Reconstructed position at " << sourceLon << "\t" << sourceLat << "\t" << 1e-3*sourceAlt << std::endl;
     std::cout << "They are separated by " << distKm << " km"  << std::endl;
-    std::cout << "Event bearing = " << eventBearing << "\t" << pat->heading << "\t" << summary->peak[AnitaPol::kVertical][0].phi << std::endl;
+    std::cout << "Event bearing = " << eventBearing << "\t" << pat->heading << "\t" << peaks.at(fakeTreeEntry).phi << std::endl;
 
     // write event number to file
-    outFile << header->eventNumber << "\t" << fakeTreeEntry << std::endl;
+    outFile << candidateEventNumber << "\t" << fakeTreeEntry << std::endl;
 
-    selectedEvents++;
     // p.inc(i, N);
     std::cout << i << "\t" << N << std::endl;
   }
 
   outFile.close();
 
+  if(scoreAll){
+    TString scoreFileName = TString::Format("candidateScores_%d_%d.root", firstRun, lastRun);
+    writeCandidateScores(scoreFileName, pool, geolocator, peaks, selectedEvents);
+  }
+
+  TCanvas* cMap = new TCanvas("cMap", "Inserted events", 1000, 1000);
   grBlindRecoPosition->SetMarkerStyle(8);
   grBlindRecoPosition->SetMarkerColor(kRed);
   grBlindRecoPosition->Draw("ap");
 
+  // Only reads the ~5000 gps entries it needs, and only the first time for these runs
   const int numPointsIWant = 5000;
-  const int selectEvery = (gpsChain->GetEntries())/numPointsIWant;
-  TString cutString = "(Entry$ % " + TString::Format("%d)==0", selectEvery);
+  FlightTrack flightTrack;
+  flightTrack.loadOrBuild(TString::Format("flightTrack_%d_%d.root", firstRun, lastRun), gpsChain, numPointsIWant);
 
-  TGraphAntarctica* grFlightPath = new TGraphAntarctica(gpsChain, "longitude", "latitude", TCut(cutString.Data()));
+  TGraphAntarctica* grFlightPath = flightTrack.makeGraph();
   grFlightPath->SetLineColor(kGreen);
   grFlightPath->Draw("lsame");
 
@@ -254,8 +335,221 @@ int main(int argc, char* argv[]){
   }
   l->Draw();
 
-  theApp->Run();
+  if(headless){
+    cMap->SaveAs(mapFileName);
+  }
+  else{
+    theApp->Run();
+  }
+
+  return 0;
+
+}
+
+
+
+
+
+//*************************************************************************
+// Selection statistics
+//*************************************************************************
+
+// One set per worker thread, so filling needs no locks, added together at the end
+struct MonteCarloHists {
+  TH1D* hNumEvents;
+  TH1D* hLog10Tries;
+  TH1D* hDistance;
+  TH1D* hBearing;
+  TH1D* hFlightTime;
+  TH1D* hFakeTreeEntry;
+  TH2D* hSourcePosition;
+  Long64_t numFailed;
+
+  MonteCarloHists(Double_t flightHours, Int_t numPulses){
+    hNumEvents = new TH1D("hNumEvents", "Number of inserted events; Number of events; Trials", 20, 0, 20);
+    hLog10Tries = new TH1D("hLog10Tries", "Random seconds drawn per inserted event; log_{10}(tries); Events", 70, 0, 7);
+    hDistance = new TH1D("hDistance", "ANITA to reconstructed position; Distance (km); Events", 200, 0, 1000);
+    hBearing = new TH1D("hBearing", "Event bearing; Bearing (Degrees); Events", 360, -180, 180);
+    hFlightTime = new TH1D("hFlightTime", "Time of inserted events; Hours since first header; Events",
+			   TMath::CeilNint(flightHours), 0, TMath::CeilNint(flightHours));
+    hFakeTreeEntry = new TH1D("hFakeTreeEntry", "Fake pulses used; fakeTreeEntry; Events", numPulses, 0, numPulses);
+    hSourcePosition = new TH2D("hSourcePosition", "Reconstructed position; Longitude (Degrees); Latitude (Degrees)",
+			       360, -180, 180, 40, -90, -50);
+    numFailed = 0;
+  }
+
+  void add(const MonteCarloHists& other){
+    hNumEvents->Add(other.hNumEvents);
+    hLog10Tries->Add(other.hLog10Tries);
+    hDistance->Add(other.hDistance);
+    hBearing->Add(other.hBearing);
+    hFlightTime->Add(other.hFlightTime);
+    hFakeTreeEntry->Add(other.hFakeTreeEntry);
+    hSourcePosition->Add(other.hSourcePosition);
+    numFailed += other.numFailed;
+  }
+
+  void write(){
+    hNumEvents->Write();
+    hLog10Tries->Write();
+    hDistance->Write();
+    hBearing->Write();
+    hFlightTime->Write();
+    hFakeTreeEntry->Write();
+    hSourcePosition->Write();
+  }
+
+  void deleteHists(){
+    delete hNumEvents;
+    delete hLog10Tries;
+    delete hDistance;
+    delete hBearing;
+    delete hFlightTime;
+    delete hFakeTreeEntry;
+    delete hSourcePosition;
+  }
+};
+
+
+
+Int_t runMonteCarlo(Long64_t numTrials, UInt_t seed, const MinBiasCandidatePool& pool,
+		    const ContinentRaster* continentRaster, const std::vector<BlindingSelection::FakePulsePeak>& peaks,
+		    UInt_t firstRealTime, UInt_t lastRealTime, Int_t numWorkers, const char* outFileName){
+
+  // The threads share out the trials, so each trial geolocates its own tries serially.
+  // Making it loads RampdemReader and AnitaGeomTool before the threads use them.
+  GeolocationBatch geolocator(pool, continentRaster, 1);
+  const Int_t batchSize = 64;
+
+  const Double_t flightHours = (lastRealTime - firstRealTime)/3600.;
+
+  TH1::AddDirectory(false);
+  std::vector<MonteCarloHists> hists;
+  for(Int_t workerInd=0; workerInd < numWorkers; workerInd++){
+    hists.push_back(MonteCarloHists(flightHours, peaks.size()));
+  }
+
+  std::cout << "Running " << numTrials << " trials of the selection with " << numWorkers << " threads" << std::endl;
+  {
+    Instrumentation::ScopedTimer t(monteCarloTimer);
+    WorkPool::process(numTrials, numWorkers, [&](Long64_t trial, Int_t workerInd){
+
+	// Trial n gets the nth stream, whichever thread runs it
+	CounterRandom rnd(seed, trial);
+	MonteCarloHists& h = hists.at(workerInd);
+
+	std::vector<BlindingSelection::SelectedEvent> selectedEvents;
+	if(BlindingSelection::select(rnd, pool, geolocator, peaks, firstRealTime, lastRealTime, batchSize, selectedEvents)!=0){
+	  h.numFailed++;
+	  return;
+	}
+
+	h.hNumEvents->Fill(selectedEvents.size());
+	Adu5Pat pat;
+	for(UInt_t i=0; i < selectedEvents.size(); i++){
+	  const BlindingSelection::SelectedEvent& selected = selectedEvents.at(i);
+	  pool.getPat(selected.candidateInd, &pat);
+	  UsefulAdu5Pat usefulPat(&pat);
+
+	  Double_t sourceLon = selected.result.sourceLon;
+	  Double_t sourceLat = selected.result.sourceLat;
+	  Double_t sourceAlt = RampdemReader::SurfaceAboveGeoid(sourceLon, sourceLat);
+	  Double_t distKm = 1e-3*usefulPat.getDistanceFromSource(sourceLat, sourceLon, sourceAlt);
+
+	  h.hLog10Tries->Fill(TMath::Log10(selected.numTries));
+	  h.hDistance->Fill(distKm);
+	  h.hBearing->Fill(selected.result.eventBearing);
+	  h.hFlightTime->Fill((pool.getRealTime(selected.candidateInd) - firstRealTime)/3600.);
+	  h.hFakeTreeEntry->Fill(selected.fakeTreeEntry);
+	  h.hSourcePosition->Fill(sourceLon, sourceLat);
+	}
+      });
+  }
+
+  MonteCarloHists& total = hists.at(0);
+  for(Int_t workerInd=1; workerInd < numWorkers; workerInd++){
+    total.add(hists.at(workerInd));
+    hists.at(workerInd).deleteHists();
+  }
+
+  std::cout << "Trials that gave up after " << BlindingSelection::maxTries << " tries: "
+	    << total.numFailed << " of " << numTrials << std::endl;
+  std::cout << "Mean number of inserted events = " << total.hNumEvents->GetMean() << std::endl;
+  std::cout << "Mean log10(tries) per inserted event = " << total.hLog10Tries->GetMean() << std::endl;
+
+  TFile* outFile = new TFile(outFileName, "recreate");
+  if(outFile->IsZombie()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open " << outFileName << std::endl;
+    delete outFile;
+    return 1;
+  }
+  total.write();
+  TNamed("numTrials", TString::Format("%lld", numTrials).Data()).Write();
+  TNamed("numFailed", TString::Format("%lld", total.numFailed).Data()).Write();
+  TNamed("seed", TString::Format("%u", seed).Data()).Write();
+  outFile->Close();
+  delete outFile;
+  total.deleteHists();
 
   return 0;
+}
+
+
 
+
+//*************************************************************************
+// Every acceptable candidate for each selected fake pulse
+//*************************************************************************
+
+Int_t writeCandidateScores(const char* fileName, const MinBiasCandidatePool& pool, const GeolocationBatch& geolocator,
+			   const std::vector<BlindingSelection::FakePulsePeak>& peaks,
+			   const std::vector<BlindingSelection::SelectedEvent>& selectedEvents){
+
+  TFile* scoreFile = new TFile(fileName, "recreate");
+  if(scoreFile->IsZombie()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open " << fileName << std::endl;
+    delete scoreFile;
+    return 1;
+  }
+
+  TTree* scoreTree = new TTree("candidateScoreTree", "Acceptable minimum bias candidates for each fake pulse");
+  Int_t scoreFakeTreeEntry = -1;
+  UInt_t scoreEventNumber = 0;
+  UInt_t scoreRealTime = 0;
+  Double_t scoreSourceLon = 0;
+  Double_t scoreSourceLat = 0;
+  Double_t scoreEventBearing = 0;
+  scoreTree->Branch("fakeTreeEntry", &scoreFakeTreeEntry);
+  scoreTree->Branch("eventNumber", &scoreEventNumber);
+  scoreTree->Branch("realTime", &scoreRealTime);
+  scoreTree->Branch("sourceLon", &scoreSourceLon);
+  scoreTree->Branch("sourceLat", &scoreSourceLat);
+  scoreTree->Branch("eventBearing", &scoreEventBearing);
+
+  for(UInt_t i=0; i < selectedEvents.size(); i++){
+    // How many candidates could have been picked for this pulse?
+    const Int_t fakeTreeEntry = selectedEvents.at(i).fakeTreeEntry;
+    std::vector<GeolocationBatch::Result> allResults;
+    geolocator.evaluateAll(peaks.at(fakeTreeEntry).phi, peaks.at(fakeTreeEntry).theta, allResults);
+    Int_t numAccepted = 0;
+    for(UInt_t candidateInd=0; candidateInd < allResults.size(); candidateInd++){
+      if(allResults[candidateInd].accepted()){
+	scoreEventNumber = pool.getEventNumber(candidateInd);
+	scoreRealTime = pool.getRealTime(candidateInd);
+	scoreSourceLon = allResults[candidateInd].sourceLon;
+	scoreSourceLat = allResults[candidateInd].sourceLat;
+	scoreEventBearing = allResults[candidateInd].eventBearing;
+	scoreFakeTreeEntry = fakeTreeEntry;
+	scoreTree->Fill();
+	numAccepted++;
+      }
+    }
+    std::cout << "fakeTreeEntry " << fakeTreeEntry << ": " << numAccepted << " of " << allResults.size()
+	      << " candidates are acceptable" << std::endl;
+  }
+
+  scoreFile->Write();
+  scoreFile->Close();
+  delete scoreFile;
+  return 0;
 }
@@ -20,17 +20,53 @@
 #include "ProgressBar.h"
 #include "FancyFFTs.h"
 
+#include "BlindingManifest.h"
+#include "ChannelRemapper.h"
+#include "BlindHeaderOverlay.h"
+#include "WorkPool.h"
+#include "DataDirectory.h"
+#include "WriterProfile.h"
+#include "Instrumentation.h"
+
+#include <mutex>
+#include <algorithm>
+
 
 TFile* fakeEventFile = NULL;
 TTree* fakeEventTree = NULL;
 UsefulAnitaEvent* fakeEvent = NULL;
 
-// pair.first is eventNumber of event to overwrite
-// pair.second is entry in fakeEventTree to overwrite it with.
-std::vector<std::pair<UInt_t, Int_t> > overwrittenEventInfo;
+// How many phi-sectors makeTreesOfWaisPulsesWithSwappedPolarizations -r rotated the fake event by,
+// the rotated copies share the WAIS pulse's eventNumber so the header looked up with it needs the same rotation
+TBranch* fakePhiRotationBranch = NULL;
+Int_t fakePhiRotation = 0;
+
+// eventNumber of event to overwrite -> entry in fakeEventTree to overwrite it with.
+BlindingManifest overwrittenEventInfo;
+
+// fakeTreeEntry -> the (unswapped) WAIS pulse header for that fake event, rotated like the fake event
+std::map<Int_t, RawAnitaHeader> fakeHeaders;
+
+WriterProfile writerProfile;
+
+std::mutex coutMutex;
+
+Instrumentation::Timer readTimer("headTree GetEntry");
+Instrumentation::Timer lookupTimer("manifest lookup");
+Instrumentation::Timer overwriteTimer("overwrite header");
+Instrumentation::Timer fillTimer("headTree Fill");
+Instrumentation::Timer writeTimer("Write");
+Instrumentation::Timer fastCloneTimer("fast clone");
+Instrumentation::Counter headersCounter("headers");
+Instrumentation::Counter overwrittenCounter("overwritten headers");
 
 void loadBlindTrees();
-Int_t isEventToOverwrite(UInt_t eventNumber);
+void loadFakeHeaders();
+Bool_t loadFakeHeaderCache(const char* fileName);
+void overwriteHeader(RawAnitaHeader* headerOut, const RawAnitaHeader* fakeHeader);
+Bool_t findEntriesToOverwrite(TTree* headInTree, RawAnitaHeader*& headerIn, std::vector<Long64_t>& entries);
+Int_t makeBlindHeadTree(Int_t run, Bool_t showProgress, Bool_t fastClone);
+Int_t findBlindedHeaders(Int_t run, std::vector<RawAnitaHeader>& blindedHeaders);
 
 Int_t blindingVersion = 3; // since finishing thesis
 
@@ -39,152 +75,453 @@ int main(int argc, char* argv[]){
   // Runs near WAIS divide
   // const Int_t firstRun = 331;
   // const Int_t lastRun = 354;
-  if(argc!=2){
-    std::cerr << "Usage: " << argv[0] << " [run]" << std::endl;
+  std::vector<Int_t> runArgs;
+  Int_t numWorkers = 1;
+  Bool_t fastClone = false;
+  Bool_t overlay = false;
+  writerProfile = WriterProfile::fromEnvironment();
+  for(int i=1; i < argc; i++){
+    TString arg = argv[i];
+    if(arg=="-j" && i+1 < argc){
+      numWorkers = WorkPool::parseNumWorkers(argv[i+1]);
+      i++;
+    }
+    else if(arg=="-p" && i+1 < argc){
+      writerProfile = WriterProfile::fromName(argv[i+1]);
+      i++;
+    }
+    else if(arg=="--fast"){
+      fastClone = true;
+    }
+    else if(arg=="--overlay"){
+      overlay = true;
+    }
+    else if(arg.IsDigit()){
+      runArgs.push_back(arg.Atoi());
+    }
+    else{
+      runArgs.clear();
+      break;
+    }
+  }
+  if(runArgs.size() < 1 || runArgs.size() > 2 || runArgs.back() < runArgs.front()){
+    std::cerr << "Usage: " << argv[0] << " [run] (--fast|--overlay) (-p writerProfile)" << std::endl;
+    std::cerr << "       " << argv[0] << " [firstRun] [lastRun] -j [numThreads] (--fast|--overlay) (-p writerProfile)" << std::endl;
+    std::cerr << "--fast copies the compressed baskets of runs with no events to overwrite" << std::endl;
+    std::cerr << "--overlay only writes the overwritten headers, see BlindHeaderOverlay" << std::endl;
+    return 1;
+  }
+  if(fastClone && overlay){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", --fast and --overlay can't be used together, "
+	      << "--overlay doesn't write any header files to fast clone" << std::endl;
+    return 1;
+  }
+  const Int_t firstRun = runArgs.front();
+  const Int_t lastRun = runArgs.back();
+  if(fastClone && writerProfile.getProfile()!=WriterProfile::kDefault){
+    std::cerr << "Warning! Fast cloned runs keep the compression of the input files, the "
+	      << writerProfile.getName() << " writer profile only applies to runs with events to overwrite" << std::endl;
   }
-  const Int_t firstRun = atoi(argv[1]);
-  const Int_t lastRun = firstRun;
 
   //*************************************************************************
-  // Set up input
+  // Set up input, shared by all the runs
   //*************************************************************************
 
   loadBlindTrees();
+  loadFakeHeaders();
 
-  TChain* headChain = new TChain("headTree");
-  TChain* fakeChain = new TChain("headTree");
-  for(Int_t run=331; run <= 354; run++){
-    TString fileName = TString::Format("~/UCL/ANITA/flight1415/root/run%d/timedHeadFile%dOfflineMask.root", run, run);
-    fakeChain->Add(fileName);
+  //*************************************************************************
+  // Loop over runs
+  //*************************************************************************
+
+  const Int_t numRuns = lastRun - firstRun + 1;
+  std::vector<Int_t> runRetVals(numRuns, 0);
+  const Bool_t showProgress = numRuns==1;
+  std::vector<RawAnitaHeader> blindedHeaders;
+
+  WorkPool::process(numRuns, numWorkers, [&](Long64_t task, Int_t workerInd){
+      (void) workerInd;
+      if(overlay){
+	std::vector<RawAnitaHeader> runBlindedHeaders;
+	runRetVals.at(task) = findBlindedHeaders(firstRun + task, runBlindedHeaders);
+	std::lock_guard<std::mutex> lock(coutMutex);
+	blindedHeaders.insert(blindedHeaders.end(), runBlindedHeaders.begin(), runBlindedHeaders.end());
+      }
+      else{
+	runRetVals.at(task) = makeBlindHeadTree(firstRun + task, showProgress, fastClone);
+      }
+    });
+
+  Int_t retVal = 0;
+  for(Int_t runInd=0; runInd < numRuns; runInd++){
+    if(runRetVals.at(runInd)!=0){
+      std::cerr << "Failed to make blind header file for run " << firstRun + runInd << std::endl;
+      retVal = 1;
+    }
   }
-  fakeChain->BuildIndex("eventNumber");
-  RawAnitaHeader* fakeHeader = NULL;
-  fakeChain->SetBranchAddress("header", &fakeHeader);
+
+  if(overlay){
+    std::sort(blindedHeaders.begin(), blindedHeaders.end(),
+	      [](const RawAnitaHeader& a, const RawAnitaHeader& b){return a.eventNumber < b.eventNumber;});
+
+    TString overlayFileName = TString::Format("blindHeadOverlayV%d_%d_%d.root", blindingVersion, firstRun, lastRun);
+    if(BlindHeaderOverlay::writeFile(overlayFileName, blindedHeaders)!=0){
+      retVal = 1;
+    }
+    std::cout << "Wrote " << blindedHeaders.size() << " of " << overwrittenEventInfo.size()
+	      << " overwritten headers to " << overlayFileName.Data() << std::endl;
+  }
+
+  return retVal;
+}
+
 
 
-  for(Int_t run=firstRun; run<=lastRun; run++){
-    // TString fileName = TString::Format("~/UCL/ANITA/flight1415/root/run%d/headFile%d.root", run, run);
-    TString fileName = TString::Format("~/UCL/ANITA/flight1415/root/run%d/timedHeadFile%dOfflineMask.root", run, run);
-    headChain->Add(fileName);
+Int_t makeBlindHeadTree(Int_t run, Bool_t showProgress, Bool_t fastClone){
 
+  //*************************************************************************
+  // Set up input
+  //*************************************************************************
+
+  // TString fileName = TString::Format("~/UCL/ANITA/flight1415/root/run%d/headFile%d.root", run, run);
+  TString fileName = DataDirectory::getHeadFileName(run);
+  TFile* headInFile = TFile::Open(fileName);
+  TTree* headInTree = headInFile ? (TTree*) headInFile->Get("headTree") : NULL;
+
+  if(headInTree==NULL || headInTree->GetEntries()==0){
+    std::lock_guard<std::mutex> lock(coutMutex);
+    std::cerr << "Unable to find header file for run " << run << ". Giving up." << std::endl;
+    delete headInFile;
+    return 1;
   }
   RawAnitaHeader* headerIn = NULL;
-  headChain->SetBranchAddress("header", &headerIn);
+  headInTree->SetBranchAddress("header", &headerIn);
 
-  if(headChain->GetEntries()==0){
-    std::cerr << "Unable to find header file for run " << firstRun << ". Giving up." << std::endl;
-    return 1;
+  TString outFileName = TString::Format("blindHeadFileV%d_%d.root", blindingVersion, run);
+
+  //*************************************************************************
+  // Fast clone runs with nothing to overwrite
+  //*************************************************************************
+
+  std::vector<Long64_t> entriesToOverwrite;
+  if(fastClone && findEntriesToOverwrite(headInTree, headerIn, entriesToOverwrite) && entriesToOverwrite.size()==0){
+
+    // TTreeCloner copies the compressed baskets as they are, nothing gets unpacked
+    Instrumentation::ScopedTimer t(fastCloneTimer);
+    TFile* headOutFile = new TFile(outFileName, "recreate");
+    TTree* headOutTree = headInTree->CloneTree(-1, "fast");
+    headOutTree->SetTitle("Tree of Anita Headers");
+    headOutFile->Write();
+    headOutFile->Close();
+    headersCounter.add(headInTree->GetEntries());
+
+    {
+      std::lock_guard<std::mutex> lock(coutMutex);
+      std::cout << "Run " << run << ": fast cloned " << headInTree->GetEntries()
+		<< " entries into " << outFileName.Data() << std::endl;
+    }
+
+    delete headOutFile;
+    headInFile->Close();
+    delete headInFile;
+    delete headerIn;
+    return 0;
   }
 
   //*************************************************************************
   // Set up output
   //*************************************************************************
 
-
-  TString outFileName = TString::Format("blindHeadFileV%d_%d.root", blindingVersion, firstRun);
   TFile* headOutFile = new TFile(outFileName, "recreate");
+  writerProfile.applyTo(headOutFile);
   TTree* headOutTree = new TTree("headTree", "Tree of Anita Headers");
   RawAnitaHeader* headerOut = NULL;
   headOutTree->Branch("header", &headerOut);
+  writerProfile.applyTo(headOutTree);
+
   //*************************************************************************
-  // Loop over pulse indices
+  // Loop over headers
   //*************************************************************************
 
-  Long64_t nEntries = headChain->GetEntries();
+  Long64_t nEntries = headInTree->GetEntries();
   Long64_t maxEntry = 0; //2500;
   Long64_t startEntry = 0;
   if(maxEntry<=0 || maxEntry > nEntries) maxEntry = nEntries;
-  std::cout << "Processing " << maxEntry << " of " << nEntries << " entries." << std::endl;
-  ProgressBar p(maxEntry-startEntry);
+  if(showProgress){
+    std::cout << "Processing " << maxEntry << " of " << nEntries << " entries." << std::endl;
+  }
+  ProgressBar* p = showProgress ? new ProgressBar(maxEntry-startEntry) : NULL;
+  Int_t numOverwritten = 0;
 
   for(Long64_t entry=startEntry; entry<maxEntry; entry++){
 
-    headChain->GetEntry(entry);
+    {
+      Instrumentation::ScopedTimer t(readTimer);
+      headInTree->GetEntry(entry);
+    }
 
     //*************************************************************************
-    // Copy header and calibrated event
+    // Copy header, overwriting if it's in the manifest
     //*************************************************************************
 
-
     headerOut = headerIn;
 
-    Int_t fakeTreeEntry = isEventToOverwrite(headerIn->eventNumber);
+    Int_t fakeTreeEntry = -1;
+    {
+      Instrumentation::ScopedTimer t(lookupTimer);
+      fakeTreeEntry = overwrittenEventInfo.getFakeTreeEntry(headerIn->eventNumber);
+    }
     if(fakeTreeEntry >= 0){
+      Instrumentation::ScopedTimer t(overwriteTimer);
+      overwriteHeader(headerOut, &fakeHeaders.at(fakeTreeEntry));
+      numOverwritten++;
+    }
 
-      fakeEventTree->GetEntry(fakeTreeEntry);
-      fakeChain->GetEntryWithIndex(fakeEvent->eventNumber);
-
-      headerOut->l1TrigMask = fakeHeader->l1TrigMaskH;
-      headerOut->l1TrigMaskH = fakeHeader->l1TrigMask;
-      headerOut->phiTrigMask = fakeHeader->phiTrigMaskH;
-      headerOut->phiTrigMaskH = fakeHeader->phiTrigMask;
-      headerOut->l1TrigMaskOffline = fakeHeader->l1TrigMaskHOffline;
-      headerOut->l1TrigMaskHOffline = fakeHeader->l1TrigMaskOffline;
-      headerOut->phiTrigMaskOffline = fakeHeader->phiTrigMaskHOffline;
-      headerOut->phiTrigMaskHOffline = fakeHeader->phiTrigMaskOffline;
-
-
-      headerOut->l3TrigPattern = fakeHeader->l3TrigPatternH;
-      headerOut->l3TrigPatternH = fakeHeader->l3TrigPattern;
-
-      // looks like TObject::Clone doesn't properly copy UChar_t (maybe Char_t too?)
-      // so do this manaully here
-      headerOut->priority = fakeHeader->priority;
-      headerOut->turfUpperWord = fakeHeader->turfUpperWord;
-      headerOut->otherFlag = fakeHeader->otherFlag;
-      headerOut->errorFlag = fakeHeader->errorFlag;
-      headerOut->surfSlipFlag = fakeHeader->surfSlipFlag = fakeHeader->surfSlipFlag = fakeHeader->surfSlipFlag;
-      headerOut->nadirAntTrigMask = fakeHeader->nadirAntTrigMask;
-      headerOut->peakThetaBin = fakeHeader->peakThetaBin;
-      for(int i=0; i < 2; i++){
-	headerOut->reserved[i] = fakeHeader->reserved[i];
-      }
-      headerOut->trigType = fakeHeader->trigType;
-      headerOut->l3Type1Count = fakeHeader->l3Type1Count;
-      headerOut->bufferDepth = fakeHeader->bufferDepth;
-      headerOut->turfioReserved = fakeHeader->turfioReserved;
-      headerOut->nadirL1TrigPattern = fakeHeader->nadirL1TrigPattern;
-      headerOut->nadirL2TrigPattern = fakeHeader->nadirL2TrigPattern;
+    {
+      Instrumentation::ScopedTimer t(fillTimer);
+      headOutTree->Fill();
+    }
 
+    if(p){
+      p->inc(entry, maxEntry);
+    }
+  }
+  headersCounter.add(maxEntry-startEntry);
+  overwrittenCounter.add(numOverwritten);
+  {
+    Instrumentation::ScopedTimer t(writeTimer);
+    headOutFile->Write();
+    headOutFile->Close();
+  }
+
+  if(!showProgress){
+    std::lock_guard<std::mutex> lock(coutMutex);
+    std::cout << "Run " << run << ": wrote " << outFileName.Data() << " with " << maxEntry-startEntry
+	      << " entries (" << numOverwritten << " overwritten)" << std::endl;
+  }
+
+  delete p;
+  delete headOutFile;
+  headInFile->Close();
+  delete headInFile;
+  delete headerIn;
 
+  return 0;
+}
 
-      std::cout << headerOut->eventNumber << "\t" << headerOut->trigNum << std::endl;
-      std::cout << (fakeHeader->errorFlag & 0x1) << "\t" << (headerOut->errorFlag & 0x1) << std::endl;
-      std::cout << (fakeHeader->errorFlag & 0x2) << "\t" << (headerOut->errorFlag & 0x2) << std::endl;
-      std::cout << (fakeHeader->errorFlag & 0x4) << "\t" << (headerOut->errorFlag & 0x4) << std::endl;
-      std::cout << (fakeHeader->errorFlag & 0x8) << "\t" << (headerOut->errorFlag & 0x8) << std::endl;
-      std::cout << (fakeHeader->errorFlag & 0x10) << "\t" << (headerOut->errorFlag & 0xf) << std::endl;
 
-      std::cout << (fakeHeader->priority) << "\t" << (headerOut->priority) << std::endl;
-      std::cout << (fakeHeader->turfUpperWord) << "\t" << (headerOut->turfUpperWord) << std::endl;
-      std::cout << (fakeHeader->otherFlag) << "\t" << (headerOut->otherFlag) << std::endl;
-      std::cout << (fakeHeader->surfSlipFlag) << "\t" << (headerOut->surfSlipFlag) << std::endl;
 
-      fakeEvent = NULL;
+Bool_t findEntriesToOverwrite(TTree* headInTree, RawAnitaHeader*& headerIn, std::vector<Long64_t>& entries){
+
+  // Only unpacks the eventNumber branch, much cheaper than reading whole headers.
+  // Returns false if that's not possible, so the caller can do it the slow way.
+  TBranch* eventNumberBranch = headInTree->GetBranch("eventNumber");
+  if(eventNumberBranch==NULL){
+    return false;
+  }
+  headInTree->GetEntry(0); // so there's a header object for the sub-branch to read into
 
+  const Long64_t nEntries = headInTree->GetEntries();
+  for(Long64_t entry=0; entry < nEntries; entry++){
+    eventNumberBranch->GetEntry(entry);
+    if(overwrittenEventInfo.getFakeTreeEntry(headerIn->eventNumber) >= 0){
+      entries.push_back(entry);
     }
+  }
+  return true;
+}
+
+
 
-    headOutTree->Fill();
+Int_t findBlindedHeaders(Int_t run, std::vector<RawAnitaHeader>& blindedHeaders){
+
+  TString fileName = DataDirectory::getHeadFileName(run);
+  TFile* headInFile = TFile::Open(fileName);
+  TTree* headInTree = headInFile ? (TTree*) headInFile->Get("headTree") : NULL;
+  if(headInTree==NULL || headInTree->GetEntries()==0){
+    std::lock_guard<std::mutex> lock(coutMutex);
+    std::cerr << "Unable to find header file for run " << run << ". Giving up." << std::endl;
+    delete headInFile;
+    return 1;
+  }
+  RawAnitaHeader* headerIn = NULL;
+  headInTree->SetBranchAddress("header", &headerIn);
+
+  std::vector<Long64_t> entriesToOverwrite;
+  if(!findEntriesToOverwrite(headInTree, headerIn, entriesToOverwrite)){
+    // no split eventNumber branch, have to look at whole headers
+    for(Long64_t entry=0; entry < headInTree->GetEntries(); entry++){
+      headInTree->GetEntry(entry);
+      if(overwrittenEventInfo.getFakeTreeEntry(headerIn->eventNumber) >= 0){
+	entriesToOverwrite.push_back(entry);
+      }
+    }
+  }
 
-    p.inc(entry, maxEntry);
+  for(UInt_t i=0; i < entriesToOverwrite.size(); i++){
+    headInTree->GetEntry(entriesToOverwrite.at(i));
+    Int_t fakeTreeEntry = overwrittenEventInfo.getFakeTreeEntry(headerIn->eventNumber);
+    overwriteHeader(headerIn, &fakeHeaders.at(fakeTreeEntry));
+    blindedHeaders.push_back(*headerIn);
   }
-  headOutFile->Write();
-  headOutFile->Close();
+
+  headInFile->Close();
+  delete headInFile;
+  delete headerIn;
 
   return 0;
 }
 
 
-Int_t isEventToOverwrite(UInt_t eventNumber){
 
-  Int_t fakeTreeEntry = -1;
-  for(UInt_t i=0; i <overwrittenEventInfo.size(); i++){
-    if(overwrittenEventInfo.at(i).first==eventNumber){
-      fakeTreeEntry = overwrittenEventInfo.at(i).second;
+void overwriteHeader(RawAnitaHeader* headerOut, const RawAnitaHeader* fakeHeader){
+
+  headerOut->l1TrigMask = fakeHeader->l1TrigMaskH;
+  headerOut->l1TrigMaskH = fakeHeader->l1TrigMask;
+  headerOut->phiTrigMask = fakeHeader->phiTrigMaskH;
+  headerOut->phiTrigMaskH = fakeHeader->phiTrigMask;
+  headerOut->l1TrigMaskOffline = fakeHeader->l1TrigMaskHOffline;
+  headerOut->l1TrigMaskHOffline = fakeHeader->l1TrigMaskOffline;
+  headerOut->phiTrigMaskOffline = fakeHeader->phiTrigMaskHOffline;
+  headerOut->phiTrigMaskHOffline = fakeHeader->phiTrigMaskOffline;
+
+
+  headerOut->l3TrigPattern = fakeHeader->l3TrigPatternH;
+  headerOut->l3TrigPatternH = fakeHeader->l3TrigPattern;
+
+  // looks like TObject::Clone doesn't properly copy UChar_t (maybe Char_t too?)
+  // so do this manaully here
+  headerOut->priority = fakeHeader->priority;
+  headerOut->turfUpperWord = fakeHeader->turfUpperWord;
+  headerOut->otherFlag = fakeHeader->otherFlag;
+  headerOut->errorFlag = fakeHeader->errorFlag;
+  headerOut->surfSlipFlag = fakeHeader->surfSlipFlag;
+  headerOut->nadirAntTrigMask = fakeHeader->nadirAntTrigMask;
+  headerOut->peakThetaBin = fakeHeader->peakThetaBin;
+  for(int i=0; i < 2; i++){
+    headerOut->reserved[i] = fakeHeader->reserved[i];
+  }
+  headerOut->trigType = fakeHeader->trigType;
+  headerOut->l3Type1Count = fakeHeader->l3Type1Count;
+  headerOut->bufferDepth = fakeHeader->bufferDepth;
+  headerOut->turfioReserved = fakeHeader->turfioReserved;
+  headerOut->nadirL1TrigPattern = fakeHeader->nadirL1TrigPattern;
+  headerOut->nadirL2TrigPattern = fakeHeader->nadirL2TrigPattern;
+
+
+  std::lock_guard<std::mutex> lock(coutMutex);
+  std::cout << headerOut->eventNumber << "\t" << headerOut->trigNum << std::endl;
+  std::cout << (fakeHeader->errorFlag & 0x1) << "\t" << (headerOut->errorFlag & 0x1) << std::endl;
+  std::cout << (fakeHeader->errorFlag & 0x2) << "\t" << (headerOut->errorFlag & 0x2) << std::endl;
+  std::cout << (fakeHeader->errorFlag & 0x4) << "\t" << (headerOut->errorFlag & 0x4) << std::endl;
+  std::cout << (fakeHeader->errorFlag & 0x8) << "\t" << (headerOut->errorFlag & 0x8) << std::endl;
+  std::cout << (fakeHeader->errorFlag & 0x10) << "\t" << (headerOut->errorFlag & 0xf) << std::endl;
+
+  std::cout << (fakeHeader->priority) << "\t" << (headerOut->priority) << std::endl;
+  std::cout << (fakeHeader->turfUpperWord) << "\t" << (headerOut->turfUpperWord) << std::endl;
+  std::cout << (fakeHeader->otherFlag) << "\t" << (headerOut->otherFlag) << std::endl;
+  std::cout << (fakeHeader->surfSlipFlag) << "\t" << (headerOut->surfSlipFlag) << std::endl;
+}
+
+
+
+Bool_t loadFakeHeaderCache(const char* fileName){
+
+  // fakeHeaderCache.root is made by makeFakeHeaderCache, entry i is the header for fakeTreeEntry i
+  TFile* cacheFile = TFile::Open(fileName);
+  TTree* cacheTree = cacheFile ? (TTree*) cacheFile->Get("fakeHeaderCacheTree") : NULL;
+  if(cacheTree==NULL || cacheTree->GetEntries()!=fakeEventTree->GetEntries()){
+    delete cacheFile;
+    return false;
+  }
+
+  // only need to unpack the eventNumber of the fake events to check the cache is up to date,
+  // without that there's no cheap check so the cache can't be trusted
+  TBranch* fakeEventNumberBranch = fakeEventTree->GetBranch("eventNumber");
+  if(fakeEventNumberBranch==NULL){
+    std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", the fakeEventTree has no eventNumber branch "
+	      << "to check " << fileName << " against, treating it as stale" << std::endl;
+    delete cacheFile;
+    return false;
+  }
+  fakeEventTree->GetEntry(0);
+
+  RawAnitaHeader* fakeHeader = NULL;
+  cacheTree->SetBranchAddress("header", &fakeHeader);
+  Int_t cachePhiRotation = 0; // caches from before -r had no rotations
+  if(cacheTree->GetBranch("phiRotation")){
+    cacheTree->SetBranchAddress("phiRotation", &cachePhiRotation);
+  }
+
+  Bool_t cacheOk = true;
+  const std::vector<Int_t>& fakeTreeEntries = overwrittenEventInfo.getFakeTreeEntries();
+  for(UInt_t i=0; i < fakeTreeEntries.size(); i++){
+    Int_t fakeTreeEntry = fakeTreeEntries.at(i);
+    if(fakeHeaders.find(fakeTreeEntry)!=fakeHeaders.end()){
+      continue;
+    }
+    cacheTree->GetEntry(fakeTreeEntry);
+    fakeEventNumberBranch->GetEntry(fakeTreeEntry);
+    fakePhiRotation = 0;
+    if(fakePhiRotationBranch){
+      fakePhiRotationBranch->GetEntry(fakeTreeEntry);
+    }
+    if(fakeEvent->eventNumber!=fakeHeader->eventNumber || fakePhiRotation!=cachePhiRotation){
+      std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", " << fileName << " doesn't match the fakeEventTree, "
+		<< "re-run makeFakeHeaderCache" << std::endl;
+      cacheOk = false;
       break;
     }
+    fakeHeaders[fakeTreeEntry] = (*fakeHeader);
+  }
+
+  cacheFile->Close();
+  delete cacheFile;
+  delete fakeHeader;
+
+  if(!cacheOk){
+    fakeHeaders.clear();
   }
-  return fakeTreeEntry;
+  return cacheOk;
+}
+
+
+
+void loadFakeHeaders(){
+
+  if(loadFakeHeaderCache("fakeHeaderCache.root")){
+    return;
+  }
+  std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", no usable fakeHeaderCache.root, "
+	    << "indexing the WAIS runs instead (run makeFakeHeaderCache to avoid this)" << std::endl;
+
+  // Look up the WAIS pulse header for each fake event once, rather than once per run
+  TChain* fakeChain = new TChain("headTree");
+  for(Int_t run=331; run <= 354; run++){
+    TString fileName = DataDirectory::getHeadFileName(run);
+    fakeChain->Add(fileName);
+  }
+  fakeChain->BuildIndex("eventNumber");
+  RawAnitaHeader* fakeHeader = NULL;
+  fakeChain->SetBranchAddress("header", &fakeHeader);
+
+  const std::vector<Int_t>& fakeTreeEntries = overwrittenEventInfo.getFakeTreeEntries();
+  for(UInt_t i=0; i < fakeTreeEntries.size(); i++){
+    Int_t fakeTreeEntry = fakeTreeEntries.at(i);
+    if(fakeHeaders.find(fakeTreeEntry)!=fakeHeaders.end()){
+      continue;
+    }
+    fakeEventTree->GetEntry(fakeTreeEntry);
+    if(fakeChain->GetEntryWithIndex(fakeEvent->eventNumber) <= 0){
+      std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to find header for fake event "
+		<< fakeEvent->eventNumber << " (fakeTreeEntry " << fakeTreeEntry << ")" << std::endl;
+      exit(1);
+    }
+    fakeHeaders[fakeTreeEntry] = (*fakeHeader);
+    ChannelRemapper::rotateHeader(&fakeHeaders[fakeTreeEntry], fakePhiRotation);
+  }
+
+  delete fakeChain;
 }
 
 
@@ -198,15 +535,7 @@ void loadBlindTrees() {
   // these are the min bias event numbers to be overwritten, with the entry in the fakeEventTree
   // that is used to overwrite the event
   sprintf(fileName,"%s/anita3OverwrittenEventInfo.txt",calibDir);
-  std::ifstream overwrittenEventInfoFile(fileName);
-  char firstLine[180];
-  overwrittenEventInfoFile.getline(firstLine,179);
-  UInt_t overwrittenEventNumber;
-  Int_t fakeTreeEntry;
-  while(overwrittenEventInfoFile >> overwrittenEventNumber >> fakeTreeEntry){
-    overwrittenEventInfo.push_back(std::pair<UInt_t, Int_t>(overwrittenEventNumber, fakeTreeEntry));
-    // std::cout << overwrittenEventInfo.at(overwrittenEventInfo.size()-1).first << "\t" << overwrittenEventInfo.at(overwrittenEventInfo.size()-1).second << std::endl;
-  }
+  overwrittenEventInfo.readFile(fileName);
   if(overwrittenEventInfo.size()==0){
     std::cerr << "Warning in " << __FILE__ << std::endl;
     std::cerr << "Unable to find overwrittenEventInfo" << std::endl;
@@ -216,5 +545,10 @@ void loadBlindTrees() {
   fakeEventFile = TFile::Open("fakeEventFile.root");
   fakeEventTree = (TTree*) fakeEventFile->Get("eventTree");
   fakeEventTree->SetBranchAddress("event", &fakeEvent);
+  fakePhiRotation = 0;
+  fakePhiRotationBranch = fakeEventTree->GetBranch("phiRotation");
+  if(fakePhiRotationBranch){
+    fakeEventTree->SetBranchAddress("phiRotation", &fakePhiRotation);
+  }
 
 }
@@ -0,0 +1,100 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Looks up the WAIS pulse header for every entry in fakeEventFile.root once and writes them to
+             fakeHeaderCache.root, so makeBlindHeadTrees doesn't have to index the WAIS runs every time.
+             Fake events that were phi rotated (they have a phiRotation branch) get their header rotated to match.
+*************************************************************************************************************** */
+
+#include "TFile.h"
+#include "TChain.h"
+#include "TTree.h"
+
+#include "RawAnitaHeader.h"
+#include "UsefulAnitaEvent.h"
+
+#include "ProgressBar.h"
+#include "DataDirectory.h"
+#include "ChannelRemapper.h"
+
+int main(int argc, char* argv[]){
+
+  if(argc > 2){
+    std::cerr << "Usage: " << argv[0] << " (fakeEventFile.root)" << std::endl;
+    return 1;
+  }
+  const char* fakeEventFileName = argc==2 ? argv[1] : "fakeEventFile.root";
+
+  //*************************************************************************
+  // Set up input
+  //*************************************************************************
+
+  TFile* fakeEventFile = TFile::Open(fakeEventFileName);
+  TTree* fakeEventTree = fakeEventFile ? (TTree*) fakeEventFile->Get("eventTree") : NULL;
+  if(fakeEventTree==NULL){
+    std::cerr << "Unable to find eventTree in " << fakeEventFileName << ". Giving up." << std::endl;
+    return 1;
+  }
+  UsefulAnitaEvent* fakeEvent = NULL;
+  fakeEventTree->SetBranchAddress("event", &fakeEvent);
+  Int_t phiRotation = 0;
+  if(fakeEventTree->GetBranch("phiRotation")){
+    fakeEventTree->SetBranchAddress("phiRotation", &phiRotation);
+  }
+
+  // Runs near WAIS divide
+  TChain* fakeChain = new TChain("headTree");
+  for(Int_t run=331; run <= 354; run++){
+    TString fileName = DataDirectory::getHeadFileName(run);
+    fakeChain->Add(fileName);
+  }
+  fakeChain->BuildIndex("eventNumber");
+  RawAnitaHeader* fakeHeader = NULL;
+  fakeChain->SetBranchAddress("header", &fakeHeader);
+
+  //*************************************************************************
+  // Set up output
+  //*************************************************************************
+
+  TFile* cacheFile = new TFile("fakeHeaderCache.root", "recreate");
+  TTree* cacheTree = new TTree("fakeHeaderCacheTree", "WAIS pulse headers of the fake events, one per fakeEventTree entry");
+  Int_t fakeTreeEntry = -1;
+  UInt_t eventNumber = 0;
+  cacheTree->Branch("fakeTreeEntry", &fakeTreeEntry);
+  cacheTree->Branch("eventNumber", &eventNumber);
+  cacheTree->Branch("header", &fakeHeader);
+  cacheTree->Branch("phiRotation", &phiRotation);
+
+  //*************************************************************************
+  // Loop over fake events
+  //*************************************************************************
+
+  const Long64_t nEntries = fakeEventTree->GetEntries();
+  ProgressBar p(nEntries);
+  for(Long64_t entry=0; entry < nEntries; entry++){
+    fakeEventTree->GetEntry(entry);
+
+    if(fakeChain->GetEntryWithIndex(fakeEvent->eventNumber) <= 0){
+      std::cerr << "Unable to find header for fake event " << fakeEvent->eventNumber
+		<< " (fakeTreeEntry " << entry << "). Giving up." << std::endl;
+      cacheFile->Close();
+      return 1;
+    }
+
+    // entry in the cache tree == entry in the fake tree
+    fakeTreeEntry = entry;
+    eventNumber = fakeEvent->eventNumber;
+    ChannelRemapper::rotateHeader(fakeHeader, phiRotation);
+    cacheTree->Fill();
+
+    p.inc(entry, nEntries);
+  }
+
+  cacheFile->Write();
+  cacheFile->Close();
+
+  return 0;
+}
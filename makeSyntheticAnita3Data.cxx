@@ -0,0 +1,595 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Writes made up ANITA-3 runs in the same layout as the flight data (run<N>/timedHeadFile<N>OfflineMask.root,
+             gpsEvent<N>.root, calEventFile<N>.root and decimatedHeadFile<N>.root), so the programs that read runs
+             can be run, load tested and benchmarked without the flight data: export ANITA_ROOT_DATA=outDir.
+             reconstruction still needs fakeHeadFile.root and fakeEventFile.root from ANITA_UTIL_INSTALL_DIR,
+             which aren't made here.
+
+             The payload goes round the continent from McMurdo, passing WAIS divide around runs 331-354.
+             Every second of realTime has a soft trigger, an ADU5 and a G12 trigger, at fixed points in the
+             second, and -n RF triggers are spread evenly through the run between them. Waveforms are
+             gaussian noise with impulses added as plane waves across the antennas: one WAIS pulse (HPol,
+             at the expected WAIS trigger time) per second while WAIS is within range, and a fraction of the
+             other RF triggers from random directions. The truth for every impulse goes in
+             run<N>/syntheticPulses<N>.root.
+
+             There are no ADC counts to calibrate, so the calEventFiles hold UsefulAnitaEvents in mV rather
+             than CalibratedAnitaEvents (CalEventReader reads either). One event of each run is read back
+             and checked against what was written.
+
+             Everything about run N comes from (seed, N), so the files are the same whatever -j is.
+*************************************************************************************************************** */
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TSystem.h"
+#include "TMath.h"
+#include "TString.h"
+
+#include "RawAnitaHeader.h"
+#include "Adu5Pat.h"
+#include "UsefulAdu5Pat.h"
+#include "UsefulAnitaEvent.h"
+#include "AnitaGeomTool.h"
+#include "RootTools.h"
+
+#include "CalEventReader.h"
+#include "CounterRandom.h"
+#include "DataDirectory.h"
+#include "WorkPool.h"
+#include "GeolocationBatch.h"
+#include "WriterProfile.h"
+#include "Instrumentation.h"
+
+#include <iostream>
+#include <mutex>
+
+Instrumentation::Timer runTimer("generate run");
+Instrumentation::Counter eventsCounter("events");
+Instrumentation::Counter pulsesCounter("impulses");
+
+//*************************************************************************
+// A roughly ANITA-3 shaped flight
+//*************************************************************************
+
+const Int_t firstFlightRun = 130;
+const UInt_t firstFlightRealTime = 1418938000; // about when run 130 started
+const Double_t secondsPerRun = 6150; // runs 130-439 took about 22 days
+
+const Double_t mcmurdoLongitude = 166.67;
+const Double_t waisLatitude = -79.468;
+const Double_t waisLongitude = -112.086;
+const Double_t maxWaisDistanceKm = 700;
+const Double_t earthRadiusKm = 6371;
+const Double_t speedOfLightMPerNs = 0.299792458;
+
+const Int_t numSamples = 256;
+const Double_t deltaT = 1./2.6;
+const Double_t noiseRmsMv = 25;
+
+// soft, ADU5 and G12, and how far into each second they come
+const Int_t numForcedTrigTypes = 3;
+const Int_t forcedTrigTypes[numForcedTrigTypes] = {8, 2, 4};
+const Double_t forcedTrigOffsets[numForcedTrigTypes] = {0.1, 0.4, 0.7};
+
+struct Settings {
+  TString outDir;
+  Int_t rfEventsPerRun;
+  Int_t eventsPerRun; // RF and forced triggers
+  ULong64_t seed;
+  Double_t impulsiveFraction;
+  Bool_t headersOnly;
+};
+
+// Read from AnitaGeomTool once, before the threads start
+struct AntennaPositions {
+  Double_t r[AnitaPol::kNotAPol][NUM_SEAVEYS];
+  Double_t z[AnitaPol::kNotAPol][NUM_SEAVEYS];
+  Double_t phi[AnitaPol::kNotAPol][NUM_SEAVEYS]; // radians
+};
+
+void getFlightPosition(Double_t secondsSinceStart, Adu5Pat* pat);
+Double_t getSourceDirection(const Adu5Pat* pat, Double_t sourceLatitude, Double_t sourceLongitude,
+			    Double_t& phiDeg, Double_t& thetaDeg);
+void fillNoise(UsefulAnitaEvent* usefulEvent, CounterRandom& rnd);
+void addImpulse(UsefulAnitaEvent* usefulEvent, const AntennaPositions& positions,
+		AnitaPol::AnitaPol_t pol, Double_t phiDeg, Double_t thetaDeg, Double_t amplitudeMv);
+Int_t checkRoundTrip(const char* calEventFileName, Long64_t entry, const UsefulAnitaEvent* written);
+Int_t generateRun(const Settings& settings, const AntennaPositions& positions, Int_t run);
+
+std::mutex coutMutex;
+
+
+
+int main(int argc, char* argv[]){
+
+  Settings settings;
+  settings.rfEventsPerRun = 10000;
+  settings.seed = 1;
+  settings.impulsiveFraction = 0.001;
+  settings.headersOnly = false;
+
+  std::vector<Int_t> runArgs;
+  Int_t numWorkers = 1;
+  for(int i=1; i < argc; i++){
+    TString arg = argv[i];
+    if(arg=="-j" && i+1 < argc){
+      numWorkers = WorkPool::parseNumWorkers(argv[i+1]);
+      i++;
+    }
+    else if(arg=="-n" && i+1 < argc){
+      settings.rfEventsPerRun = atoi(argv[i+1]);
+      i++;
+    }
+    else if(arg=="-s" && i+1 < argc){
+      settings.seed = strtoull(argv[i+1], NULL, 10);
+      i++;
+    }
+    else if(arg=="-i" && i+1 < argc){
+      settings.impulsiveFraction = atof(argv[i+1]);
+      i++;
+    }
+    else if(arg=="--headers-only"){
+      settings.headersOnly = true;
+    }
+    else if(settings.outDir.Length()==0 && !arg.IsDigit()){
+      settings.outDir = arg;
+    }
+    else if(arg.IsDigit()){
+      runArgs.push_back(arg.Atoi());
+    }
+    else{
+      runArgs.clear();
+      settings.outDir = "";
+      break;
+    }
+  }
+  if(runArgs.size()==0){
+    runArgs.push_back(331);
+    runArgs.push_back(354);
+  }
+  if(runArgs.size()==1){
+    runArgs.push_back(runArgs.at(0));
+  }
+  if(settings.outDir.Length()==0 || runArgs.size()!=2 || settings.rfEventsPerRun < 0){
+    std::cerr << "Usage: " << argv[0] << " outDir (firstRun (lastRun)) (-n rfEventsPerRun) (-s seed) (-i impulsiveFraction)"
+	      << " (-j numThreads) (--headers-only)" << std::endl;
+    std::cerr << "The default runs are 331 to 354, near WAIS divide, with 10000 RF triggers each"
+	      << " as well as the forced triggers every second" << std::endl;
+    return 1;
+  }
+  settings.eventsPerRun = settings.rfEventsPerRun + numForcedTrigTypes*TMath::CeilNint(secondsPerRun);
+  const Int_t firstRun = runArgs.at(0);
+  const Int_t lastRun = runArgs.at(1);
+
+  // eventNumber is run*eventsPerRun + entry
+  if(firstRun < 0 || lastRun < firstRun || Double_t(lastRun + 1)*settings.eventsPerRun > 4294967295.){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", can't number " << settings.eventsPerRun
+	      << " events per run up to run " << lastRun << " with a UInt_t" << std::endl;
+    return 1;
+  }
+
+  // UsefulAdu5Pat gets used in the threads
+  GeolocationBatch::warmUp();
+
+  AntennaPositions positions;
+  AnitaGeomTool* geom = AnitaGeomTool::Instance();
+  for(Int_t polInd=0; polInd < AnitaPol::kNotAPol; polInd++){
+    AnitaPol::AnitaPol_t pol = (AnitaPol::AnitaPol_t) polInd;
+    for(Int_t ant=0; ant < NUM_SEAVEYS; ant++){
+      positions.r[pol][ant] = geom->getAntR(ant, pol);
+      positions.z[pol][ant] = geom->getAntZ(ant, pol);
+      positions.phi[pol][ant] = geom->getAntPhiPositionRelToAftFore(ant, pol);
+    }
+  }
+
+  const Int_t numRuns = lastRun - firstRun + 1;
+  std::vector<Int_t> retVals(numRuns, 0);
+  WorkPool::process(numRuns, numWorkers, [&](Long64_t runInd, Int_t workerInd){
+      (void) workerInd;
+      Instrumentation::ScopedTimer t(runTimer);
+      retVals.at(runInd) = generateRun(settings, positions, firstRun + runInd);
+    });
+
+  Int_t retVal = 0;
+  for(Int_t runInd=0; runInd < numRuns; runInd++){
+    retVal += retVals.at(runInd);
+  }
+  if(retVal==0){
+    std::cout << "Wrote runs " << firstRun << " to " << lastRun << " to " << settings.outDir.Data()
+	      << ", export ANITA_ROOT_DATA=" << settings.outDir.Data() << " to use them" << std::endl;
+  }
+  return retVal==0 ? 0 : 1;
+}
+
+
+
+
+void getFlightPosition(Double_t secondsSinceStart, Adu5Pat* pat){
+
+  // Eastwards round the continent once every ~12 days, closest to WAIS divide after 15 days
+  const Double_t days = secondsSinceStart/86400;
+  Double_t longitude = mcmurdoLongitude + 29.4*days;
+  longitude = longitude - 360*TMath::FloorNint((longitude + 180)/360);
+
+  pat->latitude = -78.5 - 1.0*TMath::Cos(TMath::TwoPi()*(days - 15)/12.2);
+  pat->longitude = longitude;
+  pat->altitude = 36500 + 1500*TMath::Sin(TMath::TwoPi()*days);
+
+  // slowly spinning payload, wobbling a bit
+  const Double_t heading = 0.01*secondsSinceStart;
+  pat->heading = heading - 360*TMath::FloorNint(heading/360);
+  pat->pitch = 0.5 + 0.2*TMath::Sin(secondsSinceStart/600);
+  pat->roll = 0.1 + 0.2*TMath::Cos(secondsSinceStart/900);
+}
+
+
+
+Double_t getSourceDirection(const Adu5Pat* pat, Double_t sourceLatitude, Double_t sourceLongitude,
+			    Double_t& phiDeg, Double_t& thetaDeg){
+
+  const Double_t lat1 = pat->latitude*TMath::DegToRad();
+  const Double_t lat2 = sourceLatitude*TMath::DegToRad();
+  const Double_t deltaLon = (sourceLongitude - pat->longitude)*TMath::DegToRad();
+
+  // great circle distance and bearing (clockwise from north)
+  const Double_t a = TMath::Power(TMath::Sin(0.5*(lat2 - lat1)), 2)
+    + TMath::Cos(lat1)*TMath::Cos(lat2)*TMath::Power(TMath::Sin(0.5*deltaLon), 2);
+  const Double_t distanceKm = 2*earthRadiusKm*TMath::ASin(TMath::Sqrt(TMath::Min(1., a)));
+  const Double_t bearing = TMath::ATan2(TMath::Sin(deltaLon)*TMath::Cos(lat2),
+					TMath::Cos(lat1)*TMath::Sin(lat2) - TMath::Sin(lat1)*TMath::Cos(lat2)*TMath::Cos(deltaLon));
+
+  // payload phi goes the other way to the bearing, theta is positive down, including the curvature of the earth
+  phiDeg = pat->heading - bearing*TMath::RadToDeg();
+  phiDeg = phiDeg - 360*TMath::FloorNint(phiDeg/360);
+  const Double_t dropKm = 1e-3*pat->altitude + 0.5*distanceKm*distanceKm/earthRadiusKm;
+  thetaDeg = TMath::ATan2(dropKm, distanceKm)*TMath::RadToDeg();
+
+  return distanceKm;
+}
+
+
+
+void fillNoise(UsefulAnitaEvent* usefulEvent, CounterRandom& rnd){
+
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    usefulEvent->fNumPoints[chanIndex] = numSamples;
+    const Bool_t isClock = (chanIndex % NUM_CHAN)==NUM_CHAN-1;
+    for(Int_t samp=0; samp < numSamples; samp++){
+      const Double_t t = samp*deltaT;
+      usefulEvent->fTimes[chanIndex][samp] = t;
+      if(isClock){
+	// 33 MHz square wave
+	usefulEvent->fVolts[chanIndex][samp] = TMath::Sin(TMath::TwoPi()*0.033*t) > 0 ? 200 : -200;
+      }
+      else{
+	usefulEvent->fVolts[chanIndex][samp] = rnd.Gaus(0, noiseRmsMv);
+      }
+    }
+  }
+}
+
+
+
+void addImpulse(UsefulAnitaEvent* usefulEvent, const AntennaPositions& positions,
+		AnitaPol::AnitaPol_t pol, Double_t phiDeg, Double_t thetaDeg, Double_t amplitudeMv){
+
+  const Double_t phiWave = phiDeg*TMath::DegToRad();
+  const Double_t thetaWave = thetaDeg*TMath::DegToRad();
+  const Double_t arrivalNs = 0.4*numSamples*deltaT;
+  const Double_t decayNs = 2;
+  const Double_t freqGHz = 0.3;
+
+  for(Int_t polInd=0; polInd < AnitaPol::kNotAPol; polInd++){
+    // a little leaks into the other polarization
+    const Double_t polAmplitude = polInd==pol ? amplitudeMv : 0.1*amplitudeMv;
+    for(Int_t ant=0; ant < NUM_SEAVEYS; ant++){
+
+      // Same plane wave delays as CoherentSumKernel and CrossCorrelator
+      const Double_t antPhi = positions.phi[polInd][ant];
+      const Double_t delay = (positions.z[polInd][ant]*TMath::Sin(thetaWave)
+			      - positions.r[polInd][ant]*TMath::Cos(phiWave - antPhi)*TMath::Cos(thetaWave))/speedOfLightMPerNs;
+      const Double_t offAxisDeg = RootTools::getDeltaAngleDeg(phiDeg, antPhi*TMath::RadToDeg());
+      const Double_t gain = TMath::Exp(-0.5*offAxisDeg*offAxisDeg/(30*30));
+      if(gain < 1e-3){
+	continue;
+      }
+
+      const Int_t chanIndex = AnitaGeomTool::getChanIndexFromAntPol(ant, (AnitaPol::AnitaPol_t) polInd);
+      const Double_t t0 = arrivalNs + delay;
+      for(Int_t samp=0; samp < usefulEvent->fNumPoints[chanIndex]; samp++){
+	const Double_t dt = usefulEvent->fTimes[chanIndex][samp] - t0;
+	if(dt >= 0){
+	  usefulEvent->fVolts[chanIndex][samp] += polAmplitude*gain*TMath::Exp(-dt/decayNs)*TMath::Sin(TMath::TwoPi()*freqGHz*dt);
+	}
+      }
+    }
+  }
+}
+
+
+
+Int_t generateRun(const Settings& settings, const AntennaPositions& positions, Int_t run){
+
+  const TString runDir = TString::Format("%s/run%d", settings.outDir.Data(), run);
+  gSystem->mkdir(runDir, true);
+  if(gSystem->AccessPathName(runDir)){
+    std::lock_guard<std::mutex> lock(coutMutex);
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to make " << runDir << std::endl;
+    return 1;
+  }
+
+  //*************************************************************************
+  // Output files, same trees and branches as the flight data
+  //*************************************************************************
+
+  WriterProfile writerProfile = WriterProfile::fromEnvironment();
+
+  const Int_t numFiles = 5;
+  TString fileNames[numFiles] = {
+    DataDirectory::getRunFileName(settings.outDir, run, "timedHeadFile", "OfflineMask.root"),
+    DataDirectory::getRunFileName(settings.outDir, run, "gpsEvent"),
+    DataDirectory::getRunFileName(settings.outDir, run, "decimatedHeadFile"),
+    DataDirectory::getRunFileName(settings.outDir, run, "syntheticPulses"),
+    DataDirectory::getRunFileName(settings.outDir, run, "calEventFile")
+  };
+  TFile* files[numFiles] = {NULL};
+  const Int_t numFilesToWrite = settings.headersOnly ? numFiles - 1 : numFiles;
+  for(Int_t fileInd=0; fileInd < numFilesToWrite; fileInd++){
+    files[fileInd] = new TFile(fileNames[fileInd], "recreate");
+    if(files[fileInd]->IsZombie()){
+      std::lock_guard<std::mutex> lock(coutMutex);
+      std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open " << fileNames[fileInd] << std::endl;
+      for(Int_t i=0; i <= fileInd; i++){
+	delete files[i];
+      }
+      return 1;
+    }
+    writerProfile.applyTo(files[fileInd]);
+  }
+
+  RawAnitaHeader* header = new RawAnitaHeader();
+  Adu5Pat* pat = new Adu5Pat();
+  UInt_t eventNumber = 0;
+  UInt_t realTime = 0;
+  UsefulAnitaEvent* usefulEvent = new UsefulAnitaEvent();
+  Int_t pulsePol = 0;
+  Bool_t isWais = false;
+  Double_t pulsePhi = 0;
+  Double_t pulseTheta = 0;
+  Double_t pulseAmplitude = 0;
+
+  files[0]->cd();
+  TTree* headTree = new TTree("headTree", "Tree of Anita Headers");
+  headTree->Branch("header", &header);
+  writerProfile.applyTo(headTree);
+
+  files[1]->cd();
+  TTree* gpsTree = new TTree("adu5PatTree", "Tree of Interpolated ADU5 Positions and Attitude");
+  gpsTree->Branch("pat", &pat);
+  gpsTree->Branch("eventNumber", &eventNumber);
+  gpsTree->Branch("realTime", &realTime);
+  writerProfile.applyTo(gpsTree);
+
+  files[2]->cd();
+  TTree* decimatedTree = new TTree("headTree", "Tree of Anita Headers");
+  decimatedTree->Branch("header", &header);
+  writerProfile.applyTo(decimatedTree);
+
+  files[3]->cd();
+  TTree* pulseTree = new TTree("syntheticPulseTree", "Impulses added to the synthetic waveforms");
+  pulseTree->Branch("eventNumber", &eventNumber);
+  pulseTree->Branch("pol", &pulsePol);
+  pulseTree->Branch("isWais", &isWais);
+  pulseTree->Branch("phi", &pulsePhi);
+  pulseTree->Branch("theta", &pulseTheta);
+  pulseTree->Branch("amplitude", &pulseAmplitude);
+
+  TTree* eventTree = NULL;
+  if(!settings.headersOnly){
+    files[4]->cd();
+    eventTree = new TTree("eventTree", "Tree of Useful Anita Events");
+    eventTree->Branch("event", &usefulEvent);
+    writerProfile.applyTo(eventTree);
+  }
+
+  //*************************************************************************
+  // Forced triggers every second, RF triggers spread evenly between them
+  //*************************************************************************
+
+  CounterRandom rnd(settings.seed, run);
+  const Double_t runStart = (run - firstFlightRun)*secondsPerRun;
+  const Double_t secondsPerRfEvent = secondsPerRun/TMath::Max(1, settings.rfEventsPerRun);
+  const Int_t numForced = settings.eventsPerRun - settings.rfEventsPerRun;
+  Int_t rfInd = 0;
+  Int_t forcedInd = 0;
+  UInt_t lastRealTime = 0;
+  Bool_t hadWaisPulse = false;
+
+  // One event read back at the end, the first with an impulse if there is one
+  UsefulAnitaEvent* checkEvent = NULL;
+  Long64_t checkEntry = -1;
+  Bool_t checkHasPulse = false;
+
+  for(Int_t entry=0; entry < settings.eventsPerRun; entry++){
+
+    // whichever of the next RF and the next forced trigger comes first
+    const Double_t rfSeconds = rfInd < settings.rfEventsPerRun ? runStart + (rfInd + 0.5)*secondsPerRfEvent : 1e30;
+    const Double_t forcedSeconds = forcedInd < numForced ?
+      runStart + forcedInd/numForcedTrigTypes + forcedTrigOffsets[forcedInd % numForcedTrigTypes] : 1e30;
+    const Bool_t isForced = forcedSeconds <= rfSeconds;
+    const Double_t secondsSinceStart = isForced ? forcedSeconds : rfSeconds;
+
+    const Double_t wholeSeconds = TMath::FloorNint(secondsSinceStart);
+    realTime = firstFlightRealTime + Long64_t(wholeSeconds);
+    eventNumber = UInt_t(run)*settings.eventsPerRun + entry;
+    if(realTime!=lastRealTime){
+      lastRealTime = realTime;
+      hadWaisPulse = false;
+    }
+
+    getFlightPosition(secondsSinceStart, pat);
+    pat->run = run;
+    pat->realTime = realTime;
+    pat->readTime = realTime;
+    pat->payloadTime = realTime;
+    pat->payloadTimeUs = UInt_t(1e6*(secondsSinceStart - wholeSeconds));
+    pat->timeOfDay = 1000*(realTime % 86400);
+    pat->mrms = 0.001;
+    pat->brms = 0.01;
+    pat->attFlag = 0;
+    pat->intFlag = 0;
+
+    header->run = run;
+    header->eventNumber = eventNumber;
+    header->realTime = realTime;
+    header->payloadTime = realTime;
+    header->payloadTimeUs = pat->payloadTimeUs;
+    header->triggerTimeNs = UInt_t(1e9*(secondsSinceStart - wholeSeconds));
+    header->trigTime = header->triggerTimeNs/4;
+    header->priority = 0;
+    header->l1TrigMask = 0;
+    header->l1TrigMaskH = 0;
+    header->phiTrigMask = 0;
+    header->phiTrigMaskH = 0;
+    header->l3TrigPattern = 0;
+    header->l3TrigPatternH = 0;
+
+    if(isForced){
+      header->trigType = forcedTrigTypes[forcedInd % numForcedTrigTypes];
+      forcedInd++;
+    }
+    else{
+      header->trigType = 1;
+      rfInd++;
+    }
+
+    // Which impulse, if any
+    Bool_t hasPulse = false;
+    if(header->trigType==1){
+      Double_t waisPhi, waisTheta;
+      const Double_t waisDistanceKm = getSourceDirection(pat, waisLatitude, waisLongitude, waisPhi, waisTheta);
+      if(!hadWaisPulse && waisDistanceKm < maxWaisDistanceKm){
+	UsefulAdu5Pat usefulPat(pat);
+	header->triggerTimeNs = usefulPat.getWaisDivideTriggerTimeNs();
+	hadWaisPulse = true;
+	hasPulse = true;
+	isWais = true;
+	pulsePol = AnitaPol::kHorizontal;
+	pulsePhi = waisPhi;
+	pulseTheta = waisTheta;
+	pulseAmplitude = noiseRmsMv*rnd.Uniform(2, 12);
+      }
+      else if(rnd.Rndm() < settings.impulsiveFraction){
+	hasPulse = true;
+	isWais = false;
+	pulsePol = rnd.Rndm() < 0.5 ? AnitaPol::kHorizontal : AnitaPol::kVertical;
+	pulsePhi = rnd.Uniform(0, 360);
+	pulseTheta = rnd.Uniform(-10, 40);
+	pulseAmplitude = noiseRmsMv*rnd.Uniform(2, 20);
+      }
+    }
+
+    // Phi-sector the trigger came from
+    const Double_t triggerPhi = hasPulse ? pulsePhi : rnd.Uniform(0, 360);
+    const Int_t phiSector = TMath::FloorNint(triggerPhi/(360./NUM_PHI)) % NUM_PHI;
+    if(header->trigType==1){
+      if(!hasPulse || pulsePol==AnitaPol::kVertical){
+	header->l3TrigPattern = 1 << phiSector;
+      }
+      if(!hasPulse || pulsePol==AnitaPol::kHorizontal){
+	header->l3TrigPatternH = 1 << phiSector;
+      }
+    }
+
+    headTree->Fill();
+    gpsTree->Fill();
+    if(eventNumber % 10 == 0){
+      decimatedTree->Fill();
+    }
+    if(hasPulse){
+      pulseTree->Fill();
+      pulsesCounter.add();
+    }
+
+    if(eventTree!=NULL){
+      usefulEvent->eventNumber = eventNumber;
+      fillNoise(usefulEvent, rnd);
+      if(hasPulse){
+	addImpulse(usefulEvent, positions, (AnitaPol::AnitaPol_t) pulsePol, pulsePhi, pulseTheta, pulseAmplitude);
+      }
+      eventTree->Fill();
+      if(checkEvent==NULL || (hasPulse && !checkHasPulse)){
+	delete checkEvent;
+	checkEvent = new UsefulAnitaEvent(*usefulEvent);
+	checkEntry = entry;
+	checkHasPulse = hasPulse;
+      }
+    }
+    eventsCounter.add();
+  }
+
+  for(Int_t fileInd=0; fileInd < numFilesToWrite; fileInd++){
+    files[fileInd]->Write();
+    files[fileInd]->Close();
+    delete files[fileInd];
+  }
+  delete header;
+  delete pat;
+  delete usefulEvent;
+
+  Int_t retVal = 0;
+  if(checkEvent!=NULL){
+    retVal = checkRoundTrip(fileNames[4], checkEntry, checkEvent);
+    delete checkEvent;
+  }
+
+  {
+    std::lock_guard<std::mutex> lock(coutMutex);
+    std::cout << "Run " << run << ": " << settings.eventsPerRun << " events written to " << runDir << std::endl;
+  }
+  return retVal;
+}
+
+
+
+Int_t checkRoundTrip(const char* calEventFileName, Long64_t entry, const UsefulAnitaEvent* written){
+
+  // read back the way WaisPulseSnrIndex and makeTreesOfWaisPulsesWithSwappedPolarizations do
+  TFile* calFile = TFile::Open(calEventFileName);
+  TTree* eventTree = calFile ? (TTree*) calFile->Get("eventTree") : NULL;
+  CalEventReader calReader;
+  if(eventTree==NULL || calReader.setBranchAddress(eventTree)!=0 || eventTree->GetEntry(entry) <= 0){
+    std::lock_guard<std::mutex> lock(coutMutex);
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to read entry " << entry
+	      << " of " << calEventFileName << " back" << std::endl;
+    delete calFile;
+    return 1;
+  }
+  UsefulAnitaEvent* readBack = calReader.makeUsefulEvent();
+
+  Int_t numDifferent = readBack->eventNumber==written->eventNumber ? 0 : 1;
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    Bool_t same = readBack->fNumPoints[chanIndex]==written->fNumPoints[chanIndex];
+    for(Int_t samp=0; same && samp < written->fNumPoints[chanIndex]; samp++){
+      same = (readBack->fVolts[chanIndex][samp]==written->fVolts[chanIndex][samp] &&
+	      readBack->fTimes[chanIndex][samp]==written->fTimes[chanIndex][samp]);
+    }
+    numDifferent += same ? 0 : 1;
+  }
+  delete readBack;
+  delete calFile;
+
+  if(numDifferent > 0){
+    std::lock_guard<std::mutex> lock(coutMutex);
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", entry " << entry << " of " << calEventFileName
+	      << " read back with " << numDifferent << " channels (or the eventNumber) different to what was written" << std::endl;
+    return 1;
+  }
+  return 0;
+}
@@ -10,63 +10,131 @@
 #include "TFile.h"
 #include "TChain.h"
 #include "TTree.h"
+#include "TEnv.h"
 
 #include "RawAnitaHeader.h"
 #include "UsefulAdu5Pat.h"
+#include "Adu5Pat.h"
 #include "UsefulAnitaEvent.h"
-#include "CalibratedAnitaEvent.h"
 #include "AnitaEventCalibrator.h"
 
 #include "ProgressBar.h"
-#include "FancyFFTs.h"
+
+#include "ChannelRemapper.h"
+#include "CalEventReader.h"
+#include "FrequencyDomainFilter.h"
+#include "WaisPulseSnrIndex.h"
+#include "SparseReadPlanner.h"
+#include "DataDirectory.h"
+#include "Instrumentation.h"
+
+#include <iostream>
+#include <map>
+
+Instrumentation::Timer indexLookupTimer("eventNumber index lookup and read plan");
+Instrumentation::Timer readTimer("TChain sparse read");
+Instrumentation::Timer calibrationTimer("UsefulAnitaEvent");
+Instrumentation::Timer rotationTimer("phi rotation");
+Instrumentation::Timer swapTimer("polarization swap"); // includes the ALFA filter
+Instrumentation::Timer filterTimer("ALFA filter");
+Instrumentation::Timer fillTimer("Fill");
+Instrumentation::Timer writeTimer("Write");
 
 int main(int argc, char* argv[]){
 
   // Runs near WAIS divide
   // const Int_t firstRun = 331;
   // const Int_t lastRun = 354;
-  if(argc!=3){
-    std::cerr << "Usage: " << argv[0] << " [firstRun] [lastRun]" << std::endl;
+  std::vector<Int_t> runArgs;
+  Int_t numRotations = 1;
+  TString snrIndexFileName = "";
+  Double_t minSnr = 3;
+  Double_t maxSnr = 5;
+  Int_t nPerTree = 25;
+  Bool_t nPerTreeSet = false;
+  for(int i=1; i < argc; i++){
+    TString arg = argv[i];
+    if(arg=="-r" && i+1 < argc){
+      numRotations = atoi(argv[i+1]);
+      i++;
+    }
+    else if(arg=="--snr-index" && i+3 < argc){
+      snrIndexFileName = argv[i+1];
+      minSnr = atof(argv[i+2]);
+      maxSnr = atof(argv[i+3]);
+      i += 3;
+    }
+    else if(arg=="-n" && i+1 < argc){
+      nPerTree = atoi(argv[i+1]);
+      nPerTreeSet = true;
+      i++;
+    }
+    else if(arg.IsDigit()){
+      runArgs.push_back(arg.Atoi());
+    }
+    else{
+      runArgs.clear();
+      break;
+    }
+  }
+  if(runArgs.size()!=2 || nPerTree < 1){
+    std::cerr << "Usage: " << argv[0] << " [firstRun] [lastRun] (-r numRotations) (--snr-index waisPulseSnrIndex.root minSnr maxSnr) (-n nPerTree)" << std::endl;
+    std::cerr << "-r also writes each pulse rotated by 1, 2... numRotations-1 phi-sectors, "
+	      << "so each tree has nPerTree*numRotations entries" << std::endl;
+    std::cerr << "--snr-index picks 2*nPerTree pulses with minSnr <= HPol SNR < maxSnr from the output of scanWaisPulseSnr, "
+	      << "otherwise the original 2*25 pulses are used" << std::endl;
+    return 1;
+  }
+  if(nPerTreeSet && snrIndexFileName.Length()==0){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", -n only works with --snr-index, "
+	      << "without it the original 2*25 pulses are used" << std::endl;
+    return 1;
+  }
+  const Int_t firstRun = runArgs.at(0);
+  const Int_t lastRun = runArgs.at(1);
+  if(numRotations < 1){
+    numRotations = 1;
   }
-  const Int_t firstRun = atoi(argv[1]);
-  const Int_t lastRun = atoi(argv[2]);
 
   //*************************************************************************
   // Set up input
   //*************************************************************************
 
+  // The SparseReadPlanner caches read the next baskets in the background while this one's being used.
+  // It's a process wide setting, picked up by the files and caches opened after this, so it's done once here.
+  gEnv->SetValue("TFile.AsyncPrefetching", 1);
+
   TChain* calEventChain = new TChain("eventTree");
   TChain* headChain = new TChain("headTree");
-
-  const char* dataDir = getenv("ANITA_ROOT_DATA");
-  if(!dataDir){
-    std::cerr << "Unable to find environmental variable ANITA_ROOT_DATA" << std::endl;
-    return 1;
-  }
+  TChain* gpsChain = new TChain("adu5PatTree");
 
   for(Int_t run=firstRun; run<=lastRun; run++){
-    TString fileName = TString::Format("%s/run%d/calEventFile%d.root", dataDir, run, run);
-    calEventChain->Add(fileName);
-
-    fileName = TString::Format("%s/run%d/timedHeadFile%dOfflineMask.root", dataDir, run, run);
-    headChain->Add(fileName);
-
+    calEventChain->Add(DataDirectory::getCalEventFileName(run));
+    headChain->Add(DataDirectory::getHeadFileName(run));
+    gpsChain->Add(DataDirectory::getGpsFileName(run));
   }
 
   // std::cerr << calEventChain->GetEntries() << "\t" << headChain->GetEntries() << std::endl;
 
   headChain->BuildIndex("eventNumber");
 
-  CalibratedAnitaEvent* calEventIn = NULL;
-  calEventChain->SetBranchAddress("event", &calEventIn);
+  CalEventReader calReader;
+  if(calReader.setBranchAddress(calEventChain)!=0){
+    return 1;
+  }
   RawAnitaHeader* headerIn = NULL;
   headChain->SetBranchAddress("header", &headerIn);
 
+  // the gps tree doesn't line up entry by entry with the others so gets its own index and plan
+  gpsChain->BuildIndex("eventNumber");
+  Adu5Pat* patIn = NULL;
+  gpsChain->SetBranchAddress("pat", &patIn);
+
 
   // const int nForTree = 50;
-  const int nPerTree = 25;
   const int numPol = 2;
-  const UInt_t myPulseEventNumbers[numPol][nPerTree] = {{55602207, 55869718, 55958284, 56017375, 56130483,
+  const int nDefault = 25;
+  const UInt_t myPulseEventNumbers[numPol][nDefault] = {{55602207, 55869718, 55958284, 56017375, 56130483,
 							 56210753, 56284269, 56355124, 56445987, 56501910,
 							 56583263, 56697820, 56796435, 56949871, 57094644,
 							 57209704, 57322092, 57426865, 57519399, 57619903,
@@ -78,6 +146,85 @@ int main(int argc, char* argv[]){
 							 60630871, 60699867, 60782643, 60917975, 61252049}};
 
 
+  // The first half go in the HPol tree, the second half are swapped into the VPol tree
+  std::vector<UInt_t> pulseEventNumbers[numPol];
+  if(snrIndexFileName.Length() > 0){
+    WaisPulseSnrIndex snrIndex;
+    if(snrIndex.readFile(snrIndexFileName)!=0){
+      return 1;
+    }
+    // WAIS pulses are horizontally polarized
+    const Int_t maxDeltaTriggerTimeNs = 1000;
+    std::vector<UInt_t> selectedEventNumbers;
+    if(snrIndex.select(AnitaPol::kHorizontal, minSnr, maxSnr, maxDeltaTriggerTimeNs, numPol*nPerTree, selectedEventNumbers)!=0){
+      return 1;
+    }
+    for(Int_t i=0; i < numPol*nPerTree; i++){
+      pulseEventNumbers[i/nPerTree].push_back(selectedEventNumbers.at(i));
+    }
+  }
+  else{
+    nPerTree = nDefault;
+    for(int polInd=0; polInd < numPol; polInd++){
+      pulseEventNumbers[polInd].assign(myPulseEventNumbers[polInd], myPulseEventNumbers[polInd] + nPerTree);
+    }
+  }
+
+
+  // Worked out once, then each event is shuffled in place
+  const ChannelRemapper polSwapper = ChannelRemapper::polarizationSwap();
+  const ChannelRemapper phiRotator = ChannelRemapper::phiSectorRotation(1);
+  if(polSwapper.crossesSurfs()){
+    std::cerr << "Now what am I supposed to do?????" << std::endl;
+  }
+
+  // Where the ALFA channel ends up after the swap, it gets filtered there
+  const Int_t alfaIndex = 11*NUM_CHAN + 5;
+  const std::vector<Int_t> alfaChans(1, polSwapper.getDestination(alfaIndex));
+  FrequencyDomainFilter alfaFilter;
+  alfaFilter.addLowPass(700);
+
+
+  //*************************************************************************
+  // Plan reading every pulse once, in file order
+  //*************************************************************************
+
+  std::vector<UInt_t> allEventNumbers;
+  for(int polInd=0; polInd < numPol; polInd++){
+    allEventNumbers.insert(allEventNumbers.end(), pulseEventNumbers[polInd].begin(), pulseEventNumbers[polInd].end());
+  }
+  SparseReadPlanner readPlanner;
+  {
+    Instrumentation::ScopedTimer t(indexLookupTimer);
+    readPlanner.plan(headChain, allEventNumbers);
+  }
+
+  // Which tree each planned pulse goes in, and where it is in that tree's list of pulses
+  std::vector<Int_t> planPols(readPlanner.size(), -1);
+  std::vector<Int_t> planPulseInds(readPlanner.size(), -1);
+  for(int polInd=0; polInd < numPol; polInd++){
+    for(Int_t pulseInd=0; pulseInd < nPerTree; pulseInd++){
+      const Int_t planInd = readPlanner.find(pulseEventNumbers[polInd].at(pulseInd));
+      if(planInd >= 0){
+	planPols.at(planInd) = polInd;
+	planPulseInds.at(planInd) = pulseInd;
+      }
+    }
+  }
+
+  // Headings by eventNumber, for the phi rotations
+  std::map<UInt_t, Double_t> pulseHeadings;
+  {
+    Instrumentation::ScopedTimer t(readTimer);
+    SparseReadPlanner gpsReadPlanner;
+    gpsReadPlanner.plan(gpsChain, allEventNumbers);
+    std::vector<TTree*> chains(1, gpsChain);
+    gpsReadPlanner.read(chains, [&](Int_t planInd){
+	pulseHeadings[gpsReadPlanner.getEventNumber(planInd)] = patIn->heading;
+      });
+  }
+
+
   //*************************************************************************
   // Set up output
   //*************************************************************************
@@ -91,6 +238,19 @@ int main(int argc, char* argv[]){
   TTree* outEventTrees[AnitaPol::kNotAPol] = {NULL};
   TTree* outHeadTrees[AnitaPol::kNotAPol] = {NULL};
 
+  // Each pulse only goes in one pair of trees, so they all share the branch addresses
+  UsefulAnitaEvent* usefulEventOut = NULL;
+  RawAnitaHeader* headerOut = NULL;
+  Double_t waisEventHeading = 0;
+
+  // How many phi-sectors the entry was rotated by, so the rotated copies of a pulse (which share its eventNumber)
+  // can be told apart and makeBlindHeadTrees can rotate the WAIS header it looks up to match
+  Int_t phiRotation = 0;
+
+  // The trees are filled in file order, this is the pulse's place in the list for its tree,
+  // which the trees are indexed by
+  Int_t pulseIndex = 0;
+
   for(int polIndTree=0; polIndTree < AnitaPol::kNotAPol; polIndTree++){
     outEventTrees[polIndTree] = new TTree(polNames[polIndTree] + "EventTree", "Tree of Anita Events");
     outHeadTrees[polIndTree] = new TTree(polNames[polIndTree] + "HeadTree", "Tree of Anita Headers");
@@ -98,121 +258,59 @@ int main(int argc, char* argv[]){
     TTree* usefulEventOutTree = outEventTrees[polIndTree];
     TTree* headOutTree = outHeadTrees[polIndTree];
 
-    UsefulAnitaEvent* usefulEventOut = NULL;
     usefulEventOutTree->Branch("event", &usefulEventOut);
 
-
-    RawAnitaHeader* headerOut = NULL;
-    Double_t waisEventHeading;
     headOutTree->Branch("heading", &waisEventHeading);
     headOutTree->Branch("header", &headerOut);
 
+    headOutTree->Branch("phiRotation", &phiRotation);
+    usefulEventOutTree->Branch("phiRotation", &phiRotation);
 
+    headOutTree->Branch("pulseIndex", &pulseIndex);
+    usefulEventOutTree->Branch("pulseIndex", &pulseIndex);
+  }
 
 
+  //*************************************************************************
+  // Read every pulse once, in file order, and fill its trees straight away
+  //*************************************************************************
 
-    //*************************************************************************
-    // Loop over pulse indices
-    //*************************************************************************
-
-    const Long64_t maxEntries = nPerTree;
-    ProgressBar p(maxEntries);
-    for(Long64_t pulseInd=0; pulseInd<nPerTree; pulseInd++){
-      Long64_t entry = headChain->GetEntryNumberWithIndex(myPulseEventNumbers[polIndTree][pulseInd]);
-
-      // std::cout << entry << std::endl;
-      if(entry >= 0){
-	headChain->GetEntry(entry);
-	calEventChain->GetEntry(entry);
+  // Only the pulse being read is held, the rest are in the output trees
+  {
+    Instrumentation::ScopedTimer readTime(readTimer); // the calibration, swap and fill times are inside this one
+    std::vector<TTree*> chains;
+    chains.push_back(headChain);
+    chains.push_back(calEventChain);
+    ProgressBar p(readPlanner.size());
+    Int_t numRead = 0;
+    readPlanner.read(chains, [&](Int_t planInd){
+	const Int_t polIndTree = planPols.at(planInd);
 
 	//*************************************************************************
 	// Copy header and calibrated event
 	//*************************************************************************
-	headerOut = headerIn; // copy pointer
+	RawAnitaHeader pulseHeader = *headerIn; // the VPol tree changes it
+	headerOut = &pulseHeader;
 
-	UsefulAnitaEvent* usefulEventTemp = new UsefulAnitaEvent(calEventIn);
-	usefulEventOut = new UsefulAnitaEvent(calEventIn);
+	{
+	  Instrumentation::ScopedTimer calTime(calibrationTimer);
+	  usefulEventOut = calReader.makeUsefulEvent();
+	}
 
 	if(polIndTree==AnitaPol::kVertical){
 
+	  Instrumentation::ScopedTimer swapTime(swapTimer);
+
 	  // *************************************************************************
 	  // Swap event data between V and H channels
 	  // *************************************************************************
 
-	  for(Int_t polInd=0; polInd<AnitaPol::kNotAPol; polInd++){
-	    AnitaPol::AnitaPol_t inputPol = (AnitaPol::AnitaPol_t) polInd;
-	    AnitaPol::AnitaPol_t outputPol;
-	    if(inputPol==AnitaPol::kHorizontal) {
-	      outputPol=AnitaPol::kVertical;
-	    }
-	    else if(inputPol==AnitaPol::kVertical) {
-	      outputPol=AnitaPol::kHorizontal;
-	    }
-	    else{
-	      std::cerr << "??????" << std::endl;
-	    }
-
-	    for(Int_t ant=0; ant<NUM_SEAVEYS; ant++){
-	      Int_t inputIndex = AnitaGeomTool::getChanIndexFromAntPol(ant, inputPol);
-	      Int_t outputIndex = AnitaGeomTool::getChanIndexFromAntPol(ant, outputPol);
-
-	      Int_t surfIn, chanIn, surfOut, chanOut;
-	      AnitaGeomTool::getSurfChanFromChanIndex(inputIndex, surfIn, chanIn);
-	      AnitaGeomTool::getSurfChanFromChanIndex(outputIndex, surfOut, chanOut);
-
-	      if(surfIn != surfOut){
-		std::cerr << "Now what am I supposed to do?????" << std::endl;
-	      }
-
-	      for(int samp=0; samp<NUM_SAMP; samp++){
-		usefulEventOut->data[outputIndex][samp] = usefulEventTemp->data[inputIndex][samp];
-	      }
-	      usefulEventOut->xMax[outputIndex] = usefulEventTemp->xMax[inputIndex];
-	      usefulEventOut->xMin[outputIndex] = usefulEventTemp->xMin[inputIndex];
-	      usefulEventOut->mean[outputIndex] = usefulEventTemp->mean[inputIndex];
-	      usefulEventOut->rms[outputIndex] = usefulEventTemp->rms[inputIndex];
-
-	      usefulEventOut->fNumPoints[outputIndex] = usefulEventTemp->fNumPoints[inputIndex];
-
-	      for(int samp=0; samp < NUM_SAMP; samp++){
-		usefulEventOut->fVolts[outputIndex][samp] = usefulEventTemp->fVolts[inputIndex][samp];
-		usefulEventOut->fTimes[outputIndex][samp] = usefulEventTemp->fTimes[inputIndex][samp];
-	      }
-
-	      // if input is ALFA
-	      if(inputIndex == (11*NUM_CHAN + 5)){
-		// std::cout << usefulEventOut->fVolts[outputIndex][0] << "\t"
-		// 	      << usefulEventOut->fVolts[outputIndex][1] << "\t"
-		// 	      << usefulEventOut->fVolts[outputIndex][2] << "\t"
-		// 	      << std::endl;
-
-		std::complex<double>* theFFT = FancyFFTs::doFFT(usefulEventOut->fNumPoints[outputIndex],
-								&usefulEventOut->fVolts[outputIndex][0],
-								true);
-
-		const int nf = FancyFFTs::getNumFreqs(usefulEventOut->fNumPoints[outputIndex]);
-		double deltaF = 1e3/((1./2.6)*usefulEventOut->fNumPoints[outputIndex]);
-
-		for(int i=0; i < nf; i++){
-		  double freq = deltaF*i;
-		  if(freq >= 700){
-		    theFFT[i].real(0);
-		    theFFT[i].imag(0);
-		  }
-		}
-
-		FancyFFTs::doInvFFT(usefulEventOut->fNumPoints[outputIndex],
-				    theFFT,
-				    &usefulEventOut->fVolts[outputIndex][0],
-				    true);
-		delete [] theFFT;
-
-		// std::cout << usefulEventOut->fVolts[outputIndex][0] << "\t"
-		// 	      << usefulEventOut->fVolts[outputIndex][1] << "\t"
-		// 	      << usefulEventOut->fVolts[outputIndex][2] << "\t"
-		// 	      << std::endl;
-	      }
-	    }
+	  polSwapper.apply(usefulEventOut);
+
+	  // Filter ALFA, wherever the swap put it
+	  {
+	    Instrumentation::ScopedTimer t(filterTimer);
+	    alfaFilter.apply(usefulEventOut, alfaChans);
 	  }
 
 	  RawAnitaHeader fakeHeader2 = (*headerOut);
@@ -257,21 +355,52 @@ int main(int argc, char* argv[]){
 	// Fill new trees
 	//*************************************************************************
 
-	headOutTree->Fill();
-	usefulEventOutTree->Fill();
+	std::map<UInt_t, Double_t>::const_iterator headingIt = pulseHeadings.find(pulseHeader.eventNumber);
+	if(headingIt==pulseHeadings.end()){
+	  std::cerr << "Warning in " << __PRETTY_FUNCTION__ << ", no gps for eventNumber "
+		    << pulseHeader.eventNumber << ", heading set to 0" << std::endl;
+	}
+	const Double_t unrotatedHeading = headingIt==pulseHeadings.end() ? 0 : headingIt->second;
+
+	pulseIndex = planPulseInds.at(planInd);
+	for(Int_t rotation=0; rotation < numRotations; rotation++){
+
+	  phiRotation = rotation;
+	  waisEventHeading = unrotatedHeading;
+	  if(rotation > 0){
+	    Instrumentation::ScopedTimer t(rotationTimer);
+
+	    // one more phi-sector each time round
+	    phiRotator.apply(usefulEventOut);
+	    ChannelRemapper::rotateHeader(headerOut, 1);
+	    waisEventHeading = ChannelRemapper::rotateHeading(unrotatedHeading, rotation);
+	  }
+
+	  Instrumentation::ScopedTimer t(fillTimer);
+	  outHeadTrees[polIndTree]->Fill();
+	  outEventTrees[polIndTree]->Fill();
+	}
 
-	delete usefulEventTemp;
 	delete usefulEventOut;
 	usefulEventOut = NULL;
+	headerOut = NULL;
 
-      }
+	p.inc(numRead, readPlanner.size());
+	numRead++;
+      });
+  }
 
-      p.inc(pulseInd, nPerTree);
-    }
+  // So the entries can be read in the order of the pulse list
+  for(int polIndTree=0; polIndTree < AnitaPol::kNotAPol; polIndTree++){
+    outHeadTrees[polIndTree]->BuildIndex("pulseIndex", "phiRotation");
+    outEventTrees[polIndTree]->BuildIndex("pulseIndex", "phiRotation");
   }
 
-  outFile->Write();
-  outFile->Close();
+  {
+    Instrumentation::ScopedTimer t(writeTimer);
+    outFile->Write();
+    outFile->Close();
+  }
 
   return 0;
 }
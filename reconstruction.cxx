@@ -5,6 +5,8 @@
 
  Description:
              Reconstruct entire data set.
+             --shard i/n does the i-th of n equal ranges of headers (i from 0), so the data set can be split
+             over processes, and --merge joins the shard files back together in order (see mergeShards).
 ********************************************************************************************************* */
 
 #include "TFile.h"
@@ -16,6 +18,7 @@
 #include "TLegend.h"
 #include "TProfile2D.h"
 #include "THnSparse.h"
+#include "TNamed.h"
 
 #include "RawAnitaHeader.h"
 #include "UsefulAdu5Pat.h"
@@ -27,16 +30,109 @@
 #include "CrossCorrelator.h"
 #include "OutputConvention.h"
 #include "AnitaEventSummary.h"
-#include "FFTtools.h"
 #include "AnitaDataSet.h"
 
+#include "WriterProfile.h"
+#include "HilbertEnvelope.h"
+#include "CoherentSumKernel.h"
+#include "NotchFilterBank.h"
+#include "FrequencyDomainFilter.h"
+#include "EventNumberJoin.h"
+#include "ReconstructionCache.h"
+#include "ContentHash.h"
+#include "DataDirectory.h"
+#include "Instrumentation.h"
+
+#include <cstdio>
+
+Instrumentation::Timer readTimer("TChain read");
+Instrumentation::Timer joinTimer("eventNumber merge join");
+Instrumentation::Timer notchTimer("notches");
+Instrumentation::Timer reconstructTimer("CrossCorrelator::reconstructEvent");
+Instrumentation::Timer finePeakTimer("fine peak info");
+Instrumentation::Timer coherentSumTimer("coherent sum");
+Instrumentation::Timer hilbertTimer("Hilbert envelope");
+Instrumentation::Timer fillTimer("Fill");
+Instrumentation::Timer writeTimer("BuildIndex and Write");
+Instrumentation::Counter eventsCounter("events");
+Instrumentation::Counter cacheHitsCounter("events from the reconstruction cache");
+Instrumentation::Counter missingEventCounter("headers without an event");
+Instrumentation::Counter missingGpsCounter("headers without gps");
+
+const Int_t myNumPeaksCoarse = 5;
+const Int_t myNumPeaksFine = 5;
+const Int_t coherentDeltaPhi = 0;
+
+// Goes into every reconstruction cache key. Rebuilding the code changes the keys anyway (ReconstructionCache::addCode),
+// this is for changes that don't, e.g. to the calibration files
+const Int_t reconstructionVersion = 1;
+
+void reconstruct(CrossCorrelator* cc, FrequencyDomainFilter* notchFilter, HilbertEnvelope* hilbert,
+		 CoherentSumKernel* kernel, RawAnitaHeader* header, UsefulAnitaEvent* usefulEvent, Adu5Pat* pat,
+		 AnitaEventSummary* eventSummary);
+Int_t mergeShards(const char* outFileName, const std::vector<TString>& shardFileNames);
+
+
 int main(int argc, char *argv[]){
 
 
   const Int_t firstRun = 331;
   const Int_t lastRun = 354;
 
+  // reconstruction --merge out.root shard0.root shard1.root ...
+  if(argc > 3 && TString(argv[1])=="--merge"){
+    std::vector<TString> shardFileNames(argv + 3, argv + argc);
+    return mergeShards(argv[2], shardFileNames);
+  }
+
+  // --shard, --coherent-kernel, --notches, --pre-notch and --cache are taken out before OutputConvention sees the arguments, so they don't change the output file name.
+  // --shard and --cache don't change the summaries, the others do so they're written into the output file (see below)
+  Int_t shard = 0;
+  Int_t numShards = 1;
+  Bool_t useCoherentKernel = false;
+  Bool_t usePreNotch = false;
+  const NotchFilterBank* notches = &NotchFilterBank::anita3();
+  const char* cacheFileName = NULL;
+  std::vector<char*> ocArgs;
+  for(int i=0; i < argc; i++){
+    if(TString(argv[i])=="--shard" && i+1 < argc){
+      if(sscanf(argv[i+1], "%d/%d", &shard, &numShards)!=2 || numShards < 1 || shard < 0 || shard >= numShards){
+	std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", --shard wants i/n with 0 <= i < n, not "
+		  << argv[i+1] << std::endl;
+	return 1;
+      }
+      i++;
+    }
+    else if(TString(argv[i])=="--coherent-kernel"){
+      useCoherentKernel = true;
+    }
+    else if(TString(argv[i])=="--pre-notch"){
+      usePreNotch = true;
+    }
+    else if(TString(argv[i])=="--notches" && i+1 < argc){
+      notches = NotchFilterBank::fromFile(argv[i+1]);
+      if(notches==NULL){
+	return 1;
+      }
+      i++;
+    }
+    else if(TString(argv[i])=="--cache" && i+1 < argc){
+      cacheFileName = argv[i+1];
+      i++;
+    }
+    else{
+      ocArgs.push_back(argv[i]);
+    }
+  }
+  int ocArgc = ocArgs.size();
+  ocArgs.push_back(NULL);
+
+  // CrossCorrelator's FFTs (FancyFFTs) keep static buffers and plans per thread index, shared by every
+  // CrossCorrelator in the process, so two can't run at once. Splitting the work is done with --shard instead
   CrossCorrelator* cc = new CrossCorrelator();
+  FrequencyDomainFilter* notchFilter = usePreNotch ? new FrequencyDomainFilter() : NULL;
+  HilbertEnvelope* hilbert = new HilbertEnvelope();
+  CoherentSumKernel* kernel = useCoherentKernel ? new CoherentSumKernel() : NULL;
 
   TChain* headChain = new TChain("headTree");
   TChain* gpsChain = new TChain("adu5PatTree");
@@ -54,18 +150,26 @@ int main(int argc, char *argv[]){
 
   for(Int_t run=firstRun; run<=lastRun; run++){
 
-    TString fileName = TString::Format("~/UCL/ANITA/flight1415/root/run%d/gpsEvent%d.root", run, run);
+    TString fileName = DataDirectory::getGpsFileName(run);
     gpsChain->Add(fileName);
   }
 
 
-  OutputConvention oc(argc, argv);
+  OutputConvention oc(ocArgc, &ocArgs[0]);
   TString outFileName = oc.getOutputFileName();
+  if(numShards > 1){
+    if(outFileName.EndsWith(".root")){
+      outFileName.Resize(outFileName.Length() - 5);
+    }
+    outFileName += TString::Format("_shard%dof%d.root", shard, numShards);
+  }
   TFile* outFile = new TFile(outFileName, "recreate");
   if(outFile->IsZombie()){
     std::cerr << "Error! Unable to open output file " << outFileName.Data() << std::endl;
     return 1;
   }
+  WriterProfile writerProfile = WriterProfile::fromEnvironment();
+  writerProfile.applyTo(outFile);
 
   RawAnitaHeader* header = NULL;
   headChain->SetBranchAddress("header", &header);
@@ -74,47 +178,45 @@ int main(int argc, char *argv[]){
   eventChain->SetBranchAddress("event", &usefulEvent);
 
   Adu5Pat* pat = NULL;
+  UInt_t gpsEventNumber = 0;
   // UInt_t realTime2 = 0;
   gpsChain->SetBranchAddress("pat", &pat);
+  gpsChain->SetBranchAddress("eventNumber", &gpsEventNumber);
   // gpsChain->SetBranchAddress("realTime", &realTime2);
 
-  gpsChain->BuildIndex("eventNumber");
-  gpsChain->Show(0);
-
-
-  CrossCorrelator::SimpleNotch notch260("n260Notch", "260MHz Satellite And 200MHz Notch Notch",
-  					260-26, 260+26);
-  CrossCorrelator::SimpleNotch notch370("n370Notch", "370MHz Satellite Notch",
-  					370-26, 370+26);
-  CrossCorrelator::SimpleNotch notch400("n400Notch", "400 MHz Satellite Notch",
-  					 400-10, 410);
-  CrossCorrelator::SimpleNotch notch762("n762Notch", "762MHz Satellite Notch (one bin wide)",
-  					762-8, 762+8);
-  CrossCorrelator::SimpleNotch notch200("n200Notch", "200 MHz high pass band",
-  					0, 200);
-  CrossCorrelator::SimpleNotch notch1200("n1200Notch", "1200 MHz low pass band",
-  					 1200, 9999);
-
-  cc->addNotch(notch260);
-  cc->addNotch(notch370);
-  cc->addNotch(notch400);
-  cc->addNotch(notch762);
-  cc->addNotch(notch200);
-  cc->addNotch(notch1200);
-
-  const Int_t myNumPeaksCoarse = 5;
-  const Int_t myNumPeaksFine = 5;
-  const Int_t coherentDeltaPhi = 0;
+  // All three are in eventNumber order, so step through them together rather than indexing the gps
+  EventNumberJoin join;
+  const Int_t headInd = join.add(headChain, [&](){return header->eventNumber;});
+  const Int_t eventInd = join.add(eventChain, [&](){return usefulEvent->eventNumber;});
+  const Int_t gpsInd = join.add(gpsChain, [&](){return gpsEventNumber;});
+
+
+  // The 260, 370, 400, 762 MHz notches and the 200-1200 MHz band unless --notches says otherwise.
+  // The CrossCorrelator applies them after interpolating the waveforms to an even grid.
+  // --pre-notch applies them as one mask per waveform length to the event before the CrossCorrelator sees it instead,
+  // which is quicker but treats the unevenly sampled waveforms as evenly sampled, so the summaries aren't the same
+  if(notchFilter!=NULL){
+    notches->addTo(notchFilter);
+  }
+  else{
+    notches->addTo(cc);
+  }
+
+  // same bands, if the coherent sums are done with the kernel
+  if(kernel!=NULL){
+    notches->addTo(kernel);
+  }
 
   TTree* eventSummaryTree = new TTree("eventSummaryTree", "eventSummaryTree");
   // AnitaEventSummary* eventSummary = new AnitaEventSummary();
-  AnitaEventSummary* eventSummary = NULL; //new AnitaEventSummary();
+  AnitaEventSummary* eventSummary = new AnitaEventSummary(); // reset in place for each event
   eventSummaryTree->Branch("eventSummary", &eventSummary);
+  writerProfile.applyTo(eventSummaryTree);
 
 
   Long64_t nEntries = headChain->GetEntries();
-  Long64_t startEntry = 0;
-  Long64_t maxEntry = headChain->GetEntries();
+  Long64_t startEntry = (nEntries*shard)/numShards;
+  Long64_t maxEntry = (nEntries*(shard + 1))/numShards;
 
   std::cout << "Processing " << maxEntry-startEntry << " of " << nEntries << " entries." << std::endl;
   std::cout << "Starting at entry " << startEntry << " up to entry " << maxEntry << "." << std::endl;
@@ -122,95 +224,288 @@ int main(int argc, char *argv[]){
 
   std::cout << AnitaEventCalibrator::Instance() << std::endl;
 
-  for(Long64_t entry = startEntry; entry < maxEntry; entry++){
+  // Everything about the reconstruction that can change a summary, each event's key starts from this
+  ContentHash configHash;
+  configHash.add(reconstructionVersion);
+  ReconstructionCache::addCode(configHash);
+  configHash.add(myNumPeaksCoarse);
+  configHash.add(myNumPeaksFine);
+  configHash.add(coherentDeltaPhi);
+  configHash.add(useCoherentKernel);
+  configHash.add(usePreNotch);
+  notches->addTo(configHash);
+
+  ReconstructionCache cache;
+  if(cacheFileName!=NULL && cache.open(cacheFileName)!=0){
+    return 1;
+  }
 
-    headChain->GetEntry(entry);
-    eventChain->GetEntry(entry);
+  while(true){
+    {
+      Instrumentation::ScopedTimer t(joinTimer);
+      if(!join.next()){
+	break;
+      }
+    }
 
-    Long64_t gpsEntry = gpsChain->GetEntryNumberWithIndex(header->eventNumber);
-    if(gpsEntry < 0){
-      std::cerr << "??????? " << header->eventNumber << std::endl;
+    // this shard's range of headers
+    const Long64_t entry = join.getEntry(headInd);
+    if(entry < startEntry){
       continue;
     }
-    gpsChain->GetEntry(gpsEntry);
+    if(entry >= maxEntry){
+      break;
+    }
+
+    {
+      Instrumentation::ScopedTimer t(readTimer);
+      join.load(headInd);
+      join.load(eventInd);
+      join.load(gpsInd);
+    }
+    eventsCounter.add();
 
     // std::cout << header->realTime << "\t" << realTime2 << std::endl;
 
-    UsefulAdu5Pat usefulPat(pat);
-    cc->reconstructEvent(usefulEvent, myNumPeaksCoarse, myNumPeaksFine);
+    // the key is made before --pre-notch changes the waveforms
+    Bool_t fromCache = false;
+    ULong64_t keyHi = 0;
+    ULong64_t keyLo = 0;
+    if(cache.isOpen()){
+      ContentHash h = configHash;
+      ReconstructionCache::addEvent(h, usefulEvent);
+      ReconstructionCache::addHeader(h, header);
+      ReconstructionCache::addPat(h, pat);
+      h.digest(keyHi, keyLo);
+      fromCache = cache.find(keyHi, keyLo, eventSummary);
+      if(fromCache){
+	cacheHitsCounter.add();
+      }
+    }
+    if(!fromCache){
+      reconstruct(cc, notchFilter, hilbert, kernel, header, usefulEvent, pat, eventSummary);
+    }
+
+    for(Int_t polInd=0; polInd < AnitaPol::kNotAPol; polInd++){
+      const Int_t peakInd = 0;
+      std::cout << header->eventNumber << "\t" << polInd << "\t" <<  peakInd << "\t"
+		<< eventSummary->peak[polInd][peakInd].value << "\t"
+		<< eventSummary->peak[polInd][peakInd].phi << "\t"
+		<< eventSummary->peak[polInd][peakInd].theta << "\t"
+		<< eventSummary->peak[polInd][peakInd].longitude << "\t"
+		<< eventSummary->peak[polInd][peakInd].latitude << std::endl;
+    }
 
-    eventSummary = new AnitaEventSummary(header, &usefulPat);
-    // std::cout << eventSummary->sun.theta << "\t" << eventSummary->sun.phi << std::endl;
+    {
+      Instrumentation::ScopedTimer t(fillTimer);
+      eventSummaryTree->Fill();
+    }
+    if(cache.isOpen()){
+      cache.add(keyHi, keyLo, eventSummary);
+    }
+    // p.inc(entry, nEntries);
+  }
 
-    Double_t minY = 0;
+  // the headers that used to be printed with ???????
+  join.printSummary();
+  missingEventCounter.add(join.getNumMissing(eventInd));
+  missingGpsCounter.add(join.getNumMissing(gpsInd));
 
-    for(Int_t polInd=0; polInd < AnitaPol::kNotAPol; polInd++){
+  {
+    Instrumentation::ScopedTimer t(writeTimer);
+
+    // saves time later
+    eventSummaryTree->BuildIndex("eventNumber");
 
-      AnitaPol::AnitaPol_t pol = (AnitaPol::AnitaPol_t) polInd;
+    // the settings that change the summaries but not the file name
+    outFile->cd();
+    TNamed("coherentKernel", useCoherentKernel ? "1" : "0").Write();
+    TNamed("notches", notches->toString().Data()).Write();
+    TNamed("preNotch", usePreNotch ? "1" : "0").Write();
+    if(numShards > 1){
+      TNamed("shard", TString::Format("%d/%d", shard, numShards).Data()).Write();
+    }
+
+    outFile->Write();
+    outFile->Close();
+  }
 
-      for(Int_t peakInd=0; peakInd < myNumPeaksFine; peakInd++){
+  if(cache.isOpen() && cache.close()!=0){
+    return 1;
+  }
+
+  return 0;
+}
+
+
+
+
+void reconstruct(CrossCorrelator* cc, FrequencyDomainFilter* notchFilter, HilbertEnvelope* hilbert,
+		 CoherentSumKernel* kernel, RawAnitaHeader* header, UsefulAnitaEvent* usefulEvent, Adu5Pat* pat,
+		 AnitaEventSummary* eventSummary){
+
+  UsefulAdu5Pat usefulPat(pat);
+  if(notchFilter!=NULL){
+    Instrumentation::ScopedTimer t(notchTimer);
+    notchFilter->apply(usefulEvent, FrequencyDomainFilter::getAntennaChanIndices());
+  }
+
+  // reset in place rather than new'd each time
+  *eventSummary = AnitaEventSummary(header, &usefulPat);
+  // std::cout << eventSummary->sun.theta << "\t" << eventSummary->sun.phi << std::endl;
+
+  if(kernel!=NULL){
+    // spectra once, shared by all the peaks
+    Instrumentation::ScopedTimer t(coherentSumTimer);
+    kernel->setEvent(usefulEvent);
+  }
+
+  TGraph* grZ0s[AnitaPol::kNotAPol][myNumPeaksFine] = {{NULL}};
+  {
+    Instrumentation::ScopedTimer t(reconstructTimer);
+    cc->reconstructEvent(usefulEvent, myNumPeaksCoarse, myNumPeaksFine);
+  }
+
+  for(Int_t polInd=0; polInd < AnitaPol::kNotAPol; polInd++){
+    AnitaPol::AnitaPol_t pol = (AnitaPol::AnitaPol_t) polInd;
+    for(Int_t peakInd=0; peakInd < myNumPeaksFine; peakInd++){
+      {
+	Instrumentation::ScopedTimer t(finePeakTimer);
 	cc->getFinePeakInfo(pol, peakInd,
 			    eventSummary->peak[pol][peakInd].value,
 			    eventSummary->peak[pol][peakInd].phi,
 			    eventSummary->peak[pol][peakInd].theta);
+      }
 
-	usefulPat.getSourceLonAndLatAltZero(eventSummary->peak[pol][peakInd].phi*TMath::DegToRad(),
-					    eventSummary->peak[pol][peakInd].theta*TMath::DegToRad(),
-					    eventSummary->peak[pol][peakInd].longitude,
-					    eventSummary->peak[pol][peakInd].latitude);
-	// usefulPat.getSourceLonAndLatAtAlt(eventSummary->peak[pol][peakInd].phi*TMath::DegToRad(),
-	// 				  eventSummary->peak[pol][peakInd].theta*TMath::DegToRad(),
-	// 				  eventSummary->peak[pol][peakInd].longitude,
-	// 				  eventSummary->peak[pol][peakInd].latitude,
-	// 				  eventSummary->peak[pol][peakInd].altitude);
-
-	if(peakInd == 0){
-	  std::cout << header->eventNumber << "\t" << pol << "\t" <<  peakInd << "\t"
-		    << eventSummary->peak[pol][peakInd].value << "\t"
-		    << eventSummary->peak[pol][peakInd].phi << "\t"
-		    << eventSummary->peak[pol][peakInd].theta << "\t"
-		    << eventSummary->peak[pol][peakInd].longitude << "\t"
-		    << eventSummary->peak[pol][peakInd].latitude << std::endl;
-	}
-
-	TGraph* grZ0 = cc->makeUpsampledCoherentlySummedWaveform(pol,
-								 eventSummary->peak[pol][peakInd].phi,
-								 eventSummary->peak[pol][peakInd].theta,
-								 coherentDeltaPhi,
-								 // eventSummary->peak[pol][peakInd].snr);
-								 eventSummary->coherent[pol][peakInd].snr);
-
-	if(grZ0!=NULL){
-	  TGraph* grZ0Hilbert = FFTtools::getHilbertEnvelope(grZ0);
-
-	  RootTools::getMaxMin(grZ0Hilbert, eventSummary->coherent[pol][peakInd].peakHilbert, minY);
-
-	  delete grZ0;
-	  delete grZ0Hilbert;
-	}
+      if(kernel==NULL){
+	Instrumentation::ScopedTimer t(coherentSumTimer);
+	grZ0s[pol][peakInd] = cc->makeUpsampledCoherentlySummedWaveform(pol,
+									eventSummary->peak[pol][peakInd].phi,
+									eventSummary->peak[pol][peakInd].theta,
+									coherentDeltaPhi,
+									// eventSummary->peak[pol][peakInd].snr);
+									eventSummary->coherent[pol][peakInd].snr);
       }
     }
+  }
 
-    eventSummary->flags.isGood = 1;
-    eventSummary->flags.isPayloadBlast = 0; //!< To be determined.
-    eventSummary->flags.nadirFlag = 0; //!< Not sure I will use this.
-    eventSummary->flags.strongCWFlag = 0; //!< Not sure I will use this.
-    eventSummary->flags.isVarner = 0; //!< Not sure I will use this.
-    eventSummary->flags.isVarner2 = 0; //!< Not sure I will use this.
-    eventSummary->flags.pulser = AnitaEventSummary::EventFlags::NONE; //!< Not yet.
+  for(Int_t polInd=0; polInd < AnitaPol::kNotAPol; polInd++){
+
+    AnitaPol::AnitaPol_t pol = (AnitaPol::AnitaPol_t) polInd;
+
+    for(Int_t peakInd=0; peakInd < myNumPeaksFine; peakInd++){
+
+      usefulPat.getSourceLonAndLatAltZero(eventSummary->peak[pol][peakInd].phi*TMath::DegToRad(),
+					  eventSummary->peak[pol][peakInd].theta*TMath::DegToRad(),
+					  eventSummary->peak[pol][peakInd].longitude,
+					  eventSummary->peak[pol][peakInd].latitude);
+      // usefulPat.getSourceLonAndLatAtAlt(eventSummary->peak[pol][peakInd].phi*TMath::DegToRad(),
+      // 				  eventSummary->peak[pol][peakInd].theta*TMath::DegToRad(),
+      // 				  eventSummary->peak[pol][peakInd].longitude,
+      // 				  eventSummary->peak[pol][peakInd].latitude,
+      // 				  eventSummary->peak[pol][peakInd].altitude);
+
+      if(kernel!=NULL){
+	Instrumentation::ScopedTimer t(coherentSumTimer);
+	kernel->getPeakHilbertAndSnr(pol,
+				     eventSummary->peak[pol][peakInd].phi,
+				     eventSummary->peak[pol][peakInd].theta,
+				     coherentDeltaPhi,
+				     eventSummary->coherent[pol][peakInd].peakHilbert,
+				     eventSummary->coherent[pol][peakInd].snr);
+	continue;
+      }
 
-    // delete usefulEvent;
+      TGraph* grZ0 = grZ0s[pol][peakInd];
+      if(grZ0!=NULL){
+	Instrumentation::ScopedTimer t(hilbertTimer);
+	// same as the max of FFTtools::getHilbertEnvelope(grZ0), without the TGraphs
+	eventSummary->coherent[pol][peakInd].peakHilbert = hilbert->getPeak(grZ0->GetY(), grZ0->GetN());
 
-    eventSummaryTree->Fill();
-    // delete eventSummary;
-    // p.inc(entry, nEntries);
+	delete grZ0;
+      }
+    }
+  }
+
+  eventSummary->flags.isGood = 1;
+  eventSummary->flags.isPayloadBlast = 0; //!< To be determined.
+  eventSummary->flags.nadirFlag = 0; //!< Not sure I will use this.
+  eventSummary->flags.strongCWFlag = 0; //!< Not sure I will use this.
+  eventSummary->flags.isVarner = 0; //!< Not sure I will use this.
+  eventSummary->flags.isVarner2 = 0; //!< Not sure I will use this.
+  eventSummary->flags.pulser = AnitaEventSummary::EventFlags::NONE; //!< Not yet.
+}
+
+
+
+
+Int_t mergeShards(const char* outFileName, const std::vector<TString>& shardFileNames){
+
+  // The shards have to be all of one run's, in order, made with the same settings
+  const Int_t numShards = shardFileNames.size();
+  const Int_t numSettings = 3;
+  TString settings[numSettings];
+  const char* settingNames[numSettings] = {"coherentKernel", "notches", "preNotch"};
+  TChain* summaryChain = new TChain("eventSummaryTree");
+  for(Int_t shard=0; shard < numShards; shard++){
+    const char* shardFileName = shardFileNames.at(shard).Data();
+    TFile* shardFile = TFile::Open(shardFileName);
+    TNamed* shardName = shardFile ? (TNamed*) shardFile->Get("shard") : NULL;
+    const TString expected = TString::Format("%d/%d", shard, numShards);
+    if(shardName==NULL || expected!=shardName->GetTitle()){
+      std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", expected " << shardFileName << " to be shard "
+		<< expected << " but it's " << (shardName ? shardName->GetTitle() : "not a shard") << std::endl;
+      delete shardFile;
+      return 1;
+    }
+    for(Int_t settingInd=0; settingInd < numSettings; settingInd++){
+      TNamed* setting = (TNamed*) shardFile->Get(settingNames[settingInd]);
+      const TString value = setting ? setting->GetTitle() : "";
+      if(shard > 0 && value!=settings[settingInd]){
+	std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", " << shardFileName << " has a different "
+		  << settingNames[settingInd] << " to " << shardFileNames.at(0) << std::endl;
+	delete shardFile;
+	return 1;
+      }
+      settings[settingInd] = value;
+    }
+    delete shardFile;
+    summaryChain->Add(shardFileName);
   }
 
-  // saves time later
-  eventSummaryTree->BuildIndex("eventNumber");
+  TFile* outFile = new TFile(outFileName, "recreate");
+  if(outFile->IsZombie()){
+    std::cerr << "Error in " << __PRETTY_FUNCTION__ << ", unable to open " << outFileName << std::endl;
+    delete outFile;
+    return 1;
+  }
+  WriterProfile writerProfile = WriterProfile::fromEnvironment();
+  writerProfile.applyTo(outFile);
+
+  // shard by shard, so the entries are in the same order as one process would have written them
+  AnitaEventSummary* eventSummary = NULL;
+  summaryChain->SetBranchAddress("eventSummary", &eventSummary);
+  TTree* eventSummaryTree = summaryChain->CloneTree(0);
+  writerProfile.applyTo(eventSummaryTree);
+  const Long64_t nEntries = summaryChain->GetEntries();
+  for(Long64_t entry=0; entry < nEntries; entry++){
+    summaryChain->GetEntry(entry);
+    Instrumentation::ScopedTimer t(fillTimer);
+    eventSummaryTree->Fill();
+  }
 
-  outFile->Write();
-  outFile->Close();
+  {
+    Instrumentation::ScopedTimer t(writeTimer);
+    eventSummaryTree->BuildIndex("eventNumber");
+    outFile->cd();
+    for(Int_t settingInd=0; settingInd < numSettings; settingInd++){
+      TNamed(settingNames[settingInd], settings[settingInd].Data()).Write();
+    }
+    outFile->Write();
+    outFile->Close();
+  }
+  delete outFile;
 
+  std::cout << "Merged " << nEntries << " summaries from " << numShards << " shards into " << outFileName << std::endl;
   return 0;
 }
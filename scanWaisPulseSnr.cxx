@@ -0,0 +1,96 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Finds every WAIS divide pulse in a set of runs and measures its SNR (step 2 of the blinding).
+             Writes waisPulseSnrIndex.root, which makeTreesOfWaisPulsesWithSwappedPolarizations --snr-index
+             picks the fake pulses from.
+             Runs are scanned one after another. To split the work over processes, give each a range of runs and
+             its own -o, then scanWaisPulseSnr -o waisPulseSnrIndex.root --merge part1.root part2.root ...
+*************************************************************************************************************** */
+
+#include "TString.h"
+
+#include "WaisPulseSnrIndex.h"
+#include "DataDirectory.h"
+#include "Instrumentation.h"
+
+#include <iostream>
+
+Instrumentation::Timer scanTimer("WAIS pulse scan");
+
+int main(int argc, char* argv[]){
+
+  // Runs near WAIS divide
+  std::vector<Int_t> runArgs;
+  Int_t maxDeltaTriggerTimeNs = 2000;
+  TString outFileName = "waisPulseSnrIndex.root";
+  std::vector<TString> mergeFileNames;
+  Bool_t badArgs = false;
+  for(int i=1; i < argc; i++){
+    TString arg = argv[i];
+    if(arg=="--merge"){
+      // the rest of the arguments are files to merge
+      mergeFileNames.assign(argv + i + 1, argv + argc);
+      badArgs = mergeFileNames.size()==0 || runArgs.size() > 0;
+      break;
+    }
+    else if(arg=="-o" && i+1 < argc){
+      outFileName = argv[i+1];
+      i++;
+    }
+    else if(arg=="-t" && i+1 < argc){
+      maxDeltaTriggerTimeNs = atoi(argv[i+1]);
+      i++;
+    }
+    else if(arg.IsDigit()){
+      runArgs.push_back(arg.Atoi());
+    }
+    else{
+      badArgs = true;
+      break;
+    }
+  }
+  if(runArgs.size()==0){
+    runArgs.push_back(331);
+    runArgs.push_back(354);
+  }
+  if(badArgs || runArgs.size()!=2){
+    std::cerr << "Usage: " << argv[0] << " (firstRun lastRun) (-o waisPulseSnrIndex.root) (-t maxDeltaTriggerTimeNs)" << std::endl;
+    std::cerr << "       " << argv[0] << " (-o waisPulseSnrIndex.root) --merge index1.root index2.root ..." << std::endl;
+    std::cerr << "The default runs are 331 to 354, near WAIS divide" << std::endl;
+    return 1;
+  }
+
+  WaisPulseSnrIndex snrIndex;
+  if(mergeFileNames.size() > 0){
+    for(UInt_t i=0; i < mergeFileNames.size(); i++){
+      if(snrIndex.merge(mergeFileNames.at(i))!=0){
+	return 1;
+      }
+    }
+    std::cout << "Merged " << snrIndex.size() << " WAIS pulses from " << mergeFileNames.size() << " files" << std::endl;
+  }
+  else{
+    const Int_t firstRun = runArgs.at(0);
+    const Int_t lastRun = runArgs.at(1);
+    const TString dataDir = DataDirectory::get();
+    {
+      Instrumentation::ScopedTimer t(scanTimer);
+      if(snrIndex.build(dataDir, firstRun, lastRun, maxDeltaTriggerTimeNs)!=0){
+	return 1;
+      }
+    }
+    std::cout << "Found " << snrIndex.size() << " WAIS pulses in runs " << firstRun << " to " << lastRun << std::endl;
+  }
+  if(snrIndex.writeFile(outFileName)!=0){
+    return 1;
+  }
+
+  std::cout << snrIndex.count(AnitaPol::kHorizontal, 3, 5) << " have 3 < HPol SNR < 5" << std::endl;
+  std::cout << snrIndex.count(AnitaPol::kVertical, 3, 5) << " have 3 < VPol SNR < 5" << std::endl;
+
+  return 0;
+}
@@ -0,0 +1,144 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Checks the ChannelRemapper permutations, the in place cycle shuffle and the header rotation
+             agree with each other. Needs no data, run by ctest. Returns the number of failed checks.
+*************************************************************************************************************** */
+
+#include "ChannelRemapper.h"
+
+#include "AnitaGeomTool.h"
+#include "UsefulAnitaEvent.h"
+#include "RawAnitaHeader.h"
+
+#include <iostream>
+
+Int_t numFailed = 0;
+
+void check(Bool_t ok, const char* what){
+  if(!ok){
+    std::cerr << "FAILED: " << what << std::endl;
+    numFailed++;
+  }
+}
+
+Bool_t samePermutation(const ChannelRemapper& a, const ChannelRemapper& b){
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    if(a.getSource(chanIndex)!=b.getSource(chanIndex)){
+      return false;
+    }
+  }
+  return true;
+}
+
+Bool_t isPermutation(const ChannelRemapper& a){
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    if(a.getDestination(a.getSource(chanIndex))!=chanIndex){
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(){
+
+  const ChannelRemapper identity;
+  const ChannelRemapper polSwap = ChannelRemapper::polarizationSwap();
+
+  //*************************************************************************
+  // Permutations
+  //*************************************************************************
+
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    check(identity.getSource(chanIndex)==chanIndex, "identity leaves everything where it is");
+  }
+  check(isPermutation(polSwap), "polarizationSwap is a permutation");
+  check(samePermutation(ChannelRemapper::combine(polSwap, polSwap), identity), "polarizationSwap twice is the identity");
+  check(!polSwap.crossesSurfs(), "polarizationSwap stays on each SURF");
+
+  const ChannelRemapper rotation1 = ChannelRemapper::phiSectorRotation(1);
+  ChannelRemapper rotations = identity;
+  for(Int_t i=0; i < NUM_PHI; i++){
+    check(isPermutation(rotations), "phi rotations are permutations");
+    check(samePermutation(rotations, ChannelRemapper::phiSectorRotation(i)), "rotating by 1 i times == rotating by i");
+    rotations = ChannelRemapper::combine(rotations, rotation1);
+  }
+  check(samePermutation(rotations, identity), "rotating by 1 NUM_PHI times is the identity");
+  check(samePermutation(ChannelRemapper::phiSectorRotation(-3), ChannelRemapper::phiSectorRotation(NUM_PHI - 3)),
+	"negative rotations wrap");
+  check(samePermutation(ChannelRemapper::combine(ChannelRemapper::phiSectorRotation(5), ChannelRemapper::phiSectorRotation(7)),
+			ChannelRemapper::phiSectorRotation(12)), "combine adds rotations");
+
+  for(Int_t ant=0; ant < NUM_SEAVEYS; ant++){
+    const Int_t chanIndex = AnitaGeomTool::getChanIndexFromAntPol(ant, AnitaPol::kHorizontal);
+    const Int_t destAnt = AnitaGeomTool::getAntFromPhiRing((AnitaGeomTool::getPhiFromAnt(ant) + 3) % NUM_PHI,
+							   AnitaGeomTool::getRingFromAnt(ant));
+    check(ChannelRemapper::phiSectorRotation(3).getDestination(chanIndex)==
+	  AnitaGeomTool::getChanIndexFromAntPol(destAnt, AnitaPol::kHorizontal), "antennas move 3 phi-sectors");
+  }
+
+  //*************************************************************************
+  // The in place shuffle moves each channel to getDestination
+  //*************************************************************************
+
+  const ChannelRemapper both = ChannelRemapper::combine(polSwap, ChannelRemapper::phiSectorRotation(5));
+  UsefulAnitaEvent* usefulEvent = new UsefulAnitaEvent();
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    usefulEvent->fNumPoints[chanIndex] = 1 + chanIndex % 7;
+    usefulEvent->mean[chanIndex] = chanIndex;
+    for(Int_t samp=0; samp < usefulEvent->fNumPoints[chanIndex]; samp++){
+      usefulEvent->fVolts[chanIndex][samp] = chanIndex + 0.001*samp;
+      usefulEvent->fTimes[chanIndex][samp] = samp - chanIndex;
+    }
+  }
+  both.apply(usefulEvent);
+  for(Int_t chanIndex=0; chanIndex < NUM_DIGITZED_CHANNELS; chanIndex++){
+    const Int_t dest = both.getDestination(chanIndex);
+    check(usefulEvent->fNumPoints[dest]==1 + chanIndex % 7, "fNumPoints goes to getDestination");
+    check(usefulEvent->mean[dest]==chanIndex, "mean goes to getDestination");
+    for(Int_t samp=0; samp < usefulEvent->fNumPoints[dest]; samp++){
+      check(usefulEvent->fVolts[dest][samp]==chanIndex + 0.001*samp, "fVolts goes to getDestination");
+      check(usefulEvent->fTimes[dest][samp]==samp - chanIndex, "fTimes goes to getDestination");
+    }
+  }
+  delete usefulEvent;
+
+  //*************************************************************************
+  // Headers rotate like the channels
+  //*************************************************************************
+
+  check(ChannelRemapper::rotatePhiBits(0x1234, 0)==0x1234, "rotatePhiBits by 0");
+  check(ChannelRemapper::rotatePhiBits(0x1234, NUM_PHI)==0x1234, "rotatePhiBits by NUM_PHI");
+  check(ChannelRemapper::rotatePhiBits(0x8001, 1)==0x0003, "rotatePhiBits wraps the top bit");
+  check(ChannelRemapper::rotatePhiBits(0x0003, -1)==0x8001, "rotatePhiBits negative");
+
+  for(Int_t phi=0; phi < NUM_PHI; phi++){
+    RawAnitaHeader header;
+    header.l3TrigPatternH = 1 << phi;
+    header.phiTrigMask = ~(1 << phi) & 0xffff;
+    header.prioritizerStuff = 1 | ((4*phi + 2) << 1) | 0x100; // pol bit, phi bin, something above the phi bin
+    header.peakThetaBin = 17;
+    ChannelRemapper::rotateHeader(&header, 3);
+
+    const Int_t destPhi = (phi + 3) % NUM_PHI;
+    check(header.l3TrigPatternH==(1 << destPhi), "trigger pattern moves with the antennas");
+    check(header.phiTrigMask==(~(1 << destPhi) & 0xffff), "phi mask moves with the antennas");
+    check(header.prioritizerStuff==(1 | ((4*destPhi + 2) << 1) | 0x100), "peak phi bin moves, other bits stay");
+    check(header.peakThetaBin==17, "peakThetaBin stays");
+  }
+
+  check(ChannelRemapper::rotateHeading(10, 1)==32.5, "rotateHeading");
+  check(ChannelRemapper::rotateHeading(350, 2)==35, "rotateHeading wraps");
+  check(ChannelRemapper::rotateHeading(10, -1)==347.5, "rotateHeading negative");
+
+  if(numFailed > 0){
+    std::cerr << numFailed << " checks failed" << std::endl;
+  }
+  else{
+    std::cout << "All ChannelRemapper checks passed" << std::endl;
+  }
+  return numFailed;
+}
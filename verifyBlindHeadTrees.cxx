@@ -0,0 +1,341 @@
+// -*- C++ -*-.
+/*****************************************************************************************************************
+ Author: Ben Strutt
+ Email: b.strutt.12@ucl.ac.uk
+
+ Description:
+             Checks blindHeadFileV*_X.root against the input headers.
+             Only eventNumbers in anita3OverwrittenEventInfo.txt may differ, and only in the fields
+             makeBlindHeadTrees is supposed to overwrite. Run it after every reblinding.
+*************************************************************************************************************** */
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TBranch.h"
+#include "TLeaf.h"
+#include "TMath.h"
+
+#include "RawAnitaHeader.h"
+
+#include "BlindingManifest.h"
+#include "ContentHash.h"
+#include "WorkPool.h"
+#include "DataDirectory.h"
+
+#include <mutex>
+#include <set>
+#include <sstream>
+#include <memory>
+#include <cstring>
+
+// Header fields that makeBlindHeadTrees overwrites, anything else changing is a mistake
+const char* overwrittenFieldNames[] = {"l1TrigMask", "l1TrigMaskH", "phiTrigMask", "phiTrigMaskH",
+				       "l1TrigMaskOffline", "l1TrigMaskHOffline", "phiTrigMaskOffline", "phiTrigMaskHOffline",
+				       "l3TrigPattern", "l3TrigPatternH",
+				       "priority", "turfUpperWord", "otherFlag", "errorFlag", "surfSlipFlag",
+				       "nadirAntTrigMask", "peakThetaBin", "reserved", "trigType", "l3Type1Count",
+				       "bufferDepth", "turfioReserved", "nadirL1TrigPattern", "nadirL2TrigPattern"};
+
+BlindingManifest overwrittenEventInfo;
+std::set<TString> overwrittenFields;
+std::mutex coutMutex;
+
+struct RunReport {
+  Long64_t numEntries;
+  Long64_t numBaskets;
+  Long64_t numBasketsSkipped;
+  Int_t numOverwritten;
+  std::vector<TString> problems;
+  RunReport() : numEntries(0), numBaskets(0), numBasketsSkipped(0), numOverwritten(0) {}
+};
+
+Int_t verifyRun(Int_t run, Int_t blindingVersion, RunReport& report);
+Bool_t getBasketHashes(TBranch* branch, std::vector<ULong64_t>& hashes);
+Bool_t sameLeafValues(const TLeaf* inLeaf, const TLeaf* outLeaf);
+
+
+int main(int argc, char* argv[]){
+
+  std::vector<Int_t> runArgs;
+  Int_t numWorkers = 1;
+  Int_t blindingVersion = 3;
+  for(int i=1; i < argc; i++){
+    TString arg = argv[i];
+    if(arg=="-j" && i+1 < argc){
+      numWorkers = WorkPool::parseNumWorkers(argv[i+1]);
+      i++;
+    }
+    else if(arg=="-v" && i+1 < argc){
+      blindingVersion = atoi(argv[i+1]);
+      i++;
+    }
+    else if(arg.IsDigit()){
+      runArgs.push_back(arg.Atoi());
+    }
+    else{
+      runArgs.clear();
+      break;
+    }
+  }
+  if(runArgs.size() < 1 || runArgs.size() > 2){
+    std::cerr << "Usage: " << argv[0] << " [firstRun] (lastRun) (-j numThreads) (-v blindingVersion)" << std::endl;
+    return 1;
+  }
+  const Int_t firstRun = runArgs.front();
+  const Int_t lastRun = runArgs.back();
+
+  if(overwrittenEventInfo.readFile("anita3OverwrittenEventInfo.txt")==0){
+    std::cerr << "Unable to find overwrittenEventInfo. Giving up." << std::endl;
+    return 1;
+  }
+  for(UInt_t i=0; i < sizeof(overwrittenFieldNames)/sizeof(overwrittenFieldNames[0]); i++){
+    overwrittenFields.insert(overwrittenFieldNames[i]);
+  }
+
+  const Int_t numRuns = lastRun - firstRun + 1;
+  std::vector<RunReport> reports(numRuns);
+  std::vector<Int_t> runRetVals(numRuns, 0);
+
+  WorkPool::process(numRuns, numWorkers, [&](Long64_t task, Int_t workerInd){
+      (void) workerInd;
+      const Int_t run = firstRun + task;
+      runRetVals.at(task) = verifyRun(run, blindingVersion, reports.at(task));
+
+      std::lock_guard<std::mutex> lock(coutMutex);
+      const RunReport& r = reports.at(task);
+      std::cout << "Run " << run << ": " << r.numEntries << " entries, " << r.numBasketsSkipped << " of "
+		<< r.numBaskets << " baskets identical, " << r.numOverwritten << " overwritten, "
+		<< r.problems.size() << " problems" << std::endl;
+    });
+
+  Long64_t numProblems = 0;
+  Int_t numOverwritten = 0;
+  for(Int_t runInd=0; runInd < numRuns; runInd++){
+    if(runRetVals.at(runInd)!=0){
+      std::cerr << "Unable to verify run " << firstRun + runInd << std::endl;
+      numProblems++;
+    }
+    for(UInt_t i=0; i < reports.at(runInd).problems.size(); i++){
+      std::cerr << "Run " << firstRun + runInd << ": " << reports.at(runInd).problems.at(i).Data() << std::endl;
+    }
+    numProblems += reports.at(runInd).problems.size();
+    numOverwritten += reports.at(runInd).numOverwritten;
+  }
+
+  std::cout << "Found " << numOverwritten << " overwritten events in runs " << firstRun << "-" << lastRun
+	    << ", " << overwrittenEventInfo.size() << " listed in the manifest" << std::endl;
+  if(numProblems > 0){
+    std::cerr << "FAILED: " << numProblems << " problems found" << std::endl;
+    return 1;
+  }
+  std::cout << "OK" << std::endl;
+  return 0;
+}
+
+
+
+Int_t verifyRun(Int_t run, Int_t blindingVersion, RunReport& report){
+
+  //*************************************************************************
+  // Open the input and blinded header files
+  //*************************************************************************
+
+  // The headers are declared first so they outlive the trees reading into them
+  std::unique_ptr<RawAnitaHeader> inHeaderOwner(new RawAnitaHeader());
+  std::unique_ptr<RawAnitaHeader> outHeaderOwner(new RawAnitaHeader());
+
+  TString inFileName = DataDirectory::getHeadFileName(run);
+  TString outFileName = TString::Format("blindHeadFileV%d_%d.root", blindingVersion, run);
+  std::unique_ptr<TFile> inFile(TFile::Open(inFileName));
+  std::unique_ptr<TFile> outFile(TFile::Open(outFileName));
+  TTree* inTree = inFile ? (TTree*) inFile->Get("headTree") : NULL;
+  TTree* outTree = outFile ? (TTree*) outFile->Get("headTree") : NULL;
+  if(inTree==NULL || outTree==NULL){
+    std::lock_guard<std::mutex> lock(coutMutex);
+    std::cerr << "Unable to open " << (inTree==NULL ? inFileName.Data() : outFileName.Data()) << std::endl;
+    return 1;
+  }
+
+  report.numEntries = inTree->GetEntries();
+  if(outTree->GetEntries()!=report.numEntries){
+    report.problems.push_back(TString::Format("%lld entries in input but %lld in %s",
+					      report.numEntries, outTree->GetEntries(), outFileName.Data()));
+  }
+  const Long64_t nEntries = TMath::Min(report.numEntries, outTree->GetEntries());
+
+  RawAnitaHeader* headerIn = inHeaderOwner.get();
+  RawAnitaHeader* headerOut = outHeaderOwner.get();
+  inTree->SetBranchAddress("header", &headerIn);
+  outTree->SetBranchAddress("header", &headerOut);
+  inTree->GetEntry(0);
+  outTree->GetEntry(0);
+
+  //*************************************************************************
+  // Compare field by field, skipping baskets with identical compressed data
+  //*************************************************************************
+
+  // entry -> names of the fields that differ
+  std::map<Long64_t, std::vector<TString> > differences;
+
+  TObjArray* inLeaves = inTree->GetListOfLeaves();
+  for(Int_t leafInd=0; leafInd < inLeaves->GetEntries(); leafInd++){
+    TLeaf* inLeaf = (TLeaf*) inLeaves->At(leafInd);
+    TBranch* inBranch = inLeaf->GetBranch();
+    if(inBranch->GetListOfBranches()->GetEntries() > 0){
+      // not a data member, just the parent of some split ones
+      continue;
+    }
+
+    TLeaf* outLeaf = outTree->GetLeaf(inLeaf->GetName());
+    if(outLeaf==NULL){
+      report.problems.push_back(TString::Format("field %s is missing from %s", inLeaf->GetName(), outFileName.Data()));
+      continue;
+    }
+    TBranch* outBranch = outLeaf->GetBranch();
+
+    // which entries still need looking at in detail
+    std::vector<std::pair<Long64_t, Long64_t> > entryRanges;
+
+    std::vector<ULong64_t> inHashes, outHashes;
+    const Bool_t sameBaskets = (getBasketHashes(inBranch, inHashes) && getBasketHashes(outBranch, outHashes) &&
+				inHashes.size()==outHashes.size());
+    if(sameBaskets){
+      for(UInt_t basketInd=0; basketInd < inHashes.size(); basketInd++){
+	const Long64_t firstEntry = inBranch->GetBasketEntry()[basketInd];
+	const Long64_t lastEntry = basketInd+1 < inHashes.size() ? inBranch->GetBasketEntry()[basketInd+1] : nEntries;
+	report.numBaskets++;
+	if(outBranch->GetBasketEntry()[basketInd]==firstEntry && inHashes.at(basketInd)!=0 &&
+	   inHashes.at(basketInd)==outHashes.at(basketInd)){
+	  report.numBasketsSkipped++;
+	}
+	else{
+	  entryRanges.push_back(std::pair<Long64_t, Long64_t>(firstEntry, lastEntry));
+	}
+      }
+    }
+    else{
+      report.numBaskets += inBranch->GetWriteBasket();
+      entryRanges.push_back(std::pair<Long64_t, Long64_t>(0, nEntries));
+    }
+
+    for(UInt_t rangeInd=0; rangeInd < entryRanges.size(); rangeInd++){
+      for(Long64_t entry=entryRanges.at(rangeInd).first; entry < entryRanges.at(rangeInd).second; entry++){
+	inBranch->GetEntry(entry);
+	outBranch->GetEntry(entry);
+	if(!sameLeafValues(inLeaf, outLeaf)){
+	  differences[entry].push_back(inLeaf->GetName());
+	}
+      }
+    }
+  }
+
+  //*************************************************************************
+  // Are the differences the ones we expect?
+  //*************************************************************************
+
+  TBranch* eventNumberBranch = inTree->GetBranch("eventNumber");
+  if(eventNumberBranch==NULL){
+    // Counted once, as a problem, the run could still be read
+    report.problems.push_back(TString::Format("%s has no split eventNumber branch", inFileName.Data()));
+    return 0;
+  }
+  std::set<UInt_t> overwrittenEventNumbers;
+  for(std::map<Long64_t, std::vector<TString> >::iterator it = differences.begin(); it!=differences.end(); ++it){
+    const Long64_t entry = it->first;
+    eventNumberBranch->GetEntry(entry);
+    const UInt_t eventNumber = headerIn->eventNumber;
+
+    if(overwrittenEventInfo.getFakeTreeEntry(eventNumber) < 0){
+      std::ostringstream fields;
+      for(UInt_t i=0; i < it->second.size(); i++){
+	fields << " " << it->second.at(i).Data();
+      }
+      report.problems.push_back(TString::Format("entry %lld, eventNumber %u isn't in the manifest but differs in:%s",
+						entry, eventNumber, fields.str().c_str()));
+      continue;
+    }
+
+    overwrittenEventNumbers.insert(eventNumber);
+    for(UInt_t i=0; i < it->second.size(); i++){
+      if(overwrittenFields.find(it->second.at(i))==overwrittenFields.end()){
+	report.problems.push_back(TString::Format("entry %lld, eventNumber %u has unexpected change in %s",
+						  entry, eventNumber, it->second.at(i).Data()));
+      }
+    }
+  }
+  report.numOverwritten = overwrittenEventNumbers.size();
+
+  // Manifest events in this run that weren't touched are suspicious, but it's not impossible for the
+  // fake header to match the overwritten one, so just warn about them.
+  for(Long64_t entry=0; entry < nEntries; entry++){
+    eventNumberBranch->GetEntry(entry);
+    const UInt_t eventNumber = headerIn->eventNumber;
+    if(overwrittenEventInfo.getFakeTreeEntry(eventNumber) >= 0 &&
+       overwrittenEventNumbers.find(eventNumber)==overwrittenEventNumbers.end()){
+      std::lock_guard<std::mutex> lock(coutMutex);
+      std::cerr << "Warning! Run " << run << " eventNumber " << eventNumber
+		<< " is in the manifest but is unchanged in " << outFileName.Data() << std::endl;
+    }
+  }
+
+  inFile->Close();
+  outFile->Close();
+
+  return 0;
+}
+
+
+
+Bool_t getBasketHashes(TBranch* branch, std::vector<ULong64_t>& hashes){
+
+  // Hash of the compressed payload of each basket on disk.
+  // The key at the start of each basket holds its position and write time, which differ
+  // even for baskets copied unchanged, so it gets skipped. A hash of 0 means the basket
+  // couldn't be read, which forces a detailed comparison of its entries.
+  TFile* file = branch->GetFile();
+  if(file==NULL){
+    return false;
+  }
+
+  const Int_t numBaskets = branch->GetWriteBasket();
+  std::vector<char> buffer;
+  for(Int_t basketInd=0; basketInd < numBaskets; basketInd++){
+    const Long64_t seek = branch->GetBasketSeek(basketInd);
+    const Int_t numBytes = branch->GetBasketBytes()[basketInd];
+    ULong64_t hash = 0;
+
+    // TKey layout: Nbytes(4) Version(2) ObjLen(4) Datime(4) KeyLen(2)...
+    const Int_t keyLenOffset = 14;
+    if(seek > 0 && numBytes > keyLenOffset+2){
+      buffer.resize(numBytes);
+      if(file->ReadBuffer(&buffer[0], seek, numBytes)==kFALSE){
+	const Int_t keyLen = (((UChar_t) buffer[keyLenOffset]) << 8) | ((UChar_t) buffer[keyLenOffset+1]);
+	if(keyLen < numBytes){
+	  ContentHash h;
+	  h.add(&buffer[keyLen], numBytes - keyLen);
+	  hash = h.digest();
+	}
+      }
+    }
+    hashes.push_back(hash);
+  }
+  return true;
+}
+
+
+
+Bool_t sameLeafValues(const TLeaf* inLeaf, const TLeaf* outLeaf){
+
+  // Byte for byte, going through GetValue's Double_t would lose the low bits of 64-bit leaves
+  const Int_t len = inLeaf->GetLen();
+  const Int_t lenType = inLeaf->GetLenType();
+  if(outLeaf->GetLen()!=len || outLeaf->GetLenType()!=lenType){
+    return false;
+  }
+  const void* inValues = inLeaf->GetValuePointer();
+  const void* outValues = outLeaf->GetValuePointer();
+  if(inValues==NULL || outValues==NULL){
+    return inValues==outValues;
+  }
+  return memcmp(inValues, outValues, len*lenType)==0;
+}